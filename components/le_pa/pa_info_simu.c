@@ -73,13 +73,16 @@ static bool        ApplySimuErrorCode;
 static const simuConfig_Property_t ConfigProperties[] = {
     { .name = "psn",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_infoSimu_SetPlatformSerialNumber } } },
+                  .handler = { .stringFn = pa_infoSimu_SetPlatformSerialNumber } },
+      .defaultValuePtr = PA_SIMU_INFO_DEFAULT_PSN },
     { .name = "imei",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_infoSimu_SetImei } } },
+                  .handler = { .stringFn = pa_infoSimu_SetImei } },
+      .defaultValuePtr = PA_SIMU_INFO_DEFAULT_IMEI },
     { .name = "imeiSv",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_infoSimu_SetImeiSv } } },
+                  .handler = { .stringFn = pa_infoSimu_SetImeiSv } },
+      .defaultValuePtr = PA_SIMU_INFO_DEFAULT_IMEISV },
     {0}
 };
 
@@ -89,9 +92,9 @@ static const simuConfig_Property_t ConfigProperties[] = {
  */
 //--------------------------------------------------------------------------------------------------
 static const simuConfig_Service_t ConfigService = {
-    "info",
-    PA_SIMU_CFG_MODEM_ROOT "/info",
-    ConfigProperties
+    .namePtr = "info",
+    .configTreeRootPathPtr = PA_SIMU_CFG_MODEM_ROOT "/info",
+    .properties = ConfigProperties
 };
 
 //--------------------------------------------------------------------------------------------------
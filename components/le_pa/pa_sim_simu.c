@@ -9,6 +9,7 @@
 #include "legato.h"
 #include "pa_simu.h"
 #include "pa_sim_simu.h"
+#include "pa_sms_simu.h"
 #include "simuConfig.h"
 
 //--------------------------------------------------------------------------------------------------
@@ -79,37 +80,48 @@ static void SetIMSIFromString
 static const simuConfig_Property_t ConfigProperties[] = {
     { .name = "state",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = SetStateFromString } } },
+                  .handler = { .stringFn = SetStateFromString } },
+      .defaultValuePtr = "READY" },
     { .name = "mcc",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkMcc } } },
+                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkMcc } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_MCC },
     { .name = "mnc",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkMnc } } },
+                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkMnc } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_MNC },
     { .name = "imsi",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = SetIMSIFromString } } },
+                  .handler = { .stringFn = SetIMSIFromString } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_IMSI },
     { .name = "iccid",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetCardIdentification } } },
+                  .handler = { .stringFn = pa_simSimu_SetCardIdentification } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_ICCID },
     { .name = "eid",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetEID } } },
+                  .handler = { .stringFn = pa_simSimu_SetEID } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_EID },
     { .name = "phoneNumber",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetSubscriberPhoneNumber } } },
+                  .handler = { .stringFn = pa_simSimu_SetSubscriberPhoneNumber } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_PHONE_NUMBER },
     { .name = "operator",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkOperator } } },
+                  .handler = { .stringFn = pa_simSimu_SetHomeNetworkOperator } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_HOME_NETWORK },
     { .name = "pin",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetPIN } } },
+                  .handler = { .stringFn = pa_simSimu_SetPIN } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_PIN },
     { .name = "pinSecurity",
       .setter = { .type = SIMUCONFIG_HANDLER_BOOL,
-                  .handler = { .boolFn = pa_simSimu_SetPINSecurity } } },
+                  .handler = { .boolFn = pa_simSimu_SetPINSecurity } },
+      .defaultValuePtr = "true" },
     { .name = "puk",
       .setter = { .type = SIMUCONFIG_HANDLER_STRING,
-                  .handler = { .stringFn = pa_simSimu_SetPUK } } },
+                  .handler = { .stringFn = pa_simSimu_SetPUK } },
+      .defaultValuePtr = PA_SIMU_SIM_DEFAULT_PUK },
     {0}
 };
 
@@ -119,9 +131,9 @@ static const simuConfig_Property_t ConfigProperties[] = {
  */
 //--------------------------------------------------------------------------------------------------
 static const simuConfig_Service_t ConfigService = {
-    "sim",
-    PA_SIMU_CFG_MODEM_ROOT "/sim",
-    ConfigProperties
+    .namePtr = "sim",
+    .configTreeRootPathPtr = PA_SIMU_CFG_MODEM_ROOT "/sim",
+    .properties = ConfigProperties
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -269,6 +281,7 @@ void pa_simSimu_ReportSIMState
 )
 {
     SimState = state;
+    sms_simu_InvalidateLocalNumber();
 
     LE_DEBUG("Report SIM state %d", state);
 
@@ -852,6 +865,7 @@ void pa_simSimu_SetSubscriberPhoneNumber
 )
 {
     le_utf8_Copy(PhoneNumber, phoneNumberStr, LE_MDMDEFS_PHONE_NUM_MAX_BYTES, NULL);
+    sms_simu_InvalidateLocalNumber();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -14,1103 +14,5245 @@
 #include "pa_simu.h"
 #include "pa_sms_simu.h"
 #include "smsPdu.h"
+#include "simuConfig.h"
 
+#include <fcntl.h>
 #include <netdb.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
-#define PA_SMS_SIMU_MAX_CONN        1
-#define PA_SMS_SIMU_MAX_MSG_IN_MEM  16
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of recv() calls done for one connection before giving the hand back to the event
+ * loop, so that a busy injector cannot starve the other connections.
+ *
+ * Each read fills as much of the frame buffer as the socket allows, so it may bring several frames.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_SMS_SIMU_RX_BUDGET       32
+
+static le_event_Id_t          EventNewSmsId;
+static le_event_HandlerRef_t  NewSMSHandlerRef;
+
+static int SmsServerListenFd = -1;
+static le_fdMonitor_Ref_t SmsServerMonitorRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transport of the SMS server.
+ *
+ * The server listens on a Unix domain socket if SmsServerUnixPath is set, on the TCP port
+ * SmsServerPort of SmsServerBindAddress (or of all the IPv4 addresses if empty) otherwise.
+ * A Unix socket path starting with '@' is in the abstract namespace.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint16_t SmsServerPort = PA_SIMU_SMS_DEFAULT_PORT;
+static char SmsServerBindAddress[NI_MAXHOST] = "";
+static char SmsServerUnixPath[sizeof(((struct sockaddr_un*)0)->sun_path)] = "";
+
+// Filesystem path of the Unix socket currently bound, removed when the server is closed
+static char SmsServerBoundPath[sizeof(((struct sockaddr_un*)0)->sun_path)] = "";
+
+// The server has been started by sms_simu_Init(), transport changes restart it
+static bool SmsServerStarted;
+static bool SmsServerRestartPending;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State of one client connected to the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    le_dls_Link_t link;                                 ///< Link in SmsServerConnections
+    uint32_t id;                                        ///< Connection identifier (for logs)
+    int fd;                                             ///< Socket of the connection
+    le_fdMonitor_Ref_t fdMonitorRef;                    ///< Monitor of the socket
+    pa_sms_SimuPdu_t* rxFramePtr;                       ///< Frame being received, allocated
+                                                        ///  from a frame buffer pool
+    size_t rxLen;                                       ///< Number of bytes received in rxFramePtr
+    size_t rxSize;                                      ///< Size of the rxFramePtr buffer
+    bool rxHeaderChecked;                               ///< Header of rxFramePtr checked
+    le_dls_List_t txQueue;                              ///< Frames waiting to be sent
+    uint32_t txQueueCnt;                                ///< Number of frames in txQueue
+    size_t txOffset;                                    ///< Bytes of the first frame of txQueue
+                                                        ///  already sent
+    bool txFailed;                                      ///< A send failed, connection to close
+    bool deliveryReports;                               ///< Send PA_SIMU_SMS_FRAME_DELIVERED
+    bool concatReassembly;                              ///< Send reassembled
+                                                        ///  PA_SIMU_SMS_FRAME_CONCAT frames
+    uint32_t rxMsgCnt;                                  ///< Number of messages received
+    uint32_t txMsgCnt;                                  ///< Number of messages sent
+    uint32_t txDropCnt;                                 ///< Number of messages dropped
+}
+SmsServerConnection_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Frame queued on a connection. The entry holds a reference on the frame buffer, so that one frame
+ * can be queued on all the connections without being copied.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    le_dls_Link_t link;                 ///< Link in the txQueue of the connection
+    pa_sms_SimuPdu_t* framePtr;         ///< Frame to send
+}
+SmsServerTxEntry_t;
+
+static le_mem_PoolRef_t SmsServerTxEntryPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of frames queued on one connection. Frames sent to a connection whose queue is
+ * full are dropped, so that a slow client cannot hold an unbounded amount of memory.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SmsServerTxQueueMax = PA_SIMU_SMS_DEFAULT_TX_QUEUE_MAX;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Kinds of messages waiting for their simulated delivery.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum {
+    SMS_DELIVERY_SUBMITTED,     ///< Submitted by pa_sms_SendPduMsg(), sent to the clients and self
+    SMS_DELIVERY_SEGMENT,       ///< Segment injected by a client, stored as an incoming message
+    SMS_DELIVERY_STATUS_REPORT  ///< Status report of a submitted message, stored as incoming
+}
+SmsDeliveryType_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Message waiting for its simulated delivery.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    le_dls_Link_t link;                 ///< Link in SmsPendingDeliveries
+    le_clk_Time_t deadline;             ///< Relative time of the delivery
+    pa_sms_SimuPdu_t* framePtr;         ///< Message to deliver
+    SmsDeliveryType_t type;             ///< How to deliver the message
+}
+SmsPendingDelivery_t;
+
+static le_mem_PoolRef_t SmsPendingDeliveryPool;
+static le_dls_List_t SmsPendingDeliveries = LE_DLS_LIST_INIT;   ///< Sorted by deadline
+static le_timer_Ref_t SmsDeliveryTimer;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Simulated delay between the submission of a message and its delivery: a fixed part plus a random
+ * part up to the jitter, in milliseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SmsDeliveryDelayMs = 0;
+static uint32_t SmsDeliveryJitterMs = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Status reports of the submitted messages requesting one.
+ *
+ * The report is stored as an incoming message after a fixed delay plus a random part up to the
+ * jitter, counted from the submission. Its TP-ST is drawn from the outcomes according to their
+ * weights.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint8_t status;                     ///< TP-ST of the report
+    uint32_t weight;                    ///< Relative probability of the outcome
+}
+SmsStatusReportOutcome_t;
+
+static uint32_t SmsStatusReportDelayMs = 0;
+static uint32_t SmsStatusReportJitterMs = 0;
+static SmsStatusReportOutcome_t SmsStatusReportOutcomes[PA_SIMU_SMS_MAX_SR_OUTCOMES] = {
+    { .status = PA_SIMU_SMS_DEFAULT_SR_STATUS, .weight = 1 }
+};
+static uint32_t SmsStatusReportOutcomeCnt = 1;
+static uint32_t SmsStatusReportTotalWeight = 1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the outbound pipeline.
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_smsSimu_TxStats_t SmsTxStats;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Concatenated message being reassembled from the SMS-SUBMIT segments sent by the Legato world.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    le_dls_Link_t link;                                 ///< Link in SmsConcatReassemblies
+    char destAddress[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];   ///< Destination of the message
+    uint32_t reference;                                 ///< Reference of the message
+    uint32_t encoding;                                  ///< Encoding of the first segment
+    uint32_t segmentCnt;                                ///< Number of segments
+    uint64_t receivedMask;                              ///< Received segments, bit 0 for the first
+    le_clk_Time_t firstTime;                            ///< Relative time of the first segment
+    uint16_t segmentLen[PA_SIMU_SMS_MAX_CONCAT_CNT];    ///< User data length of each segment
+    uint8_t segmentData[PA_SIMU_SMS_MAX_CONCAT_CNT][PA_SIMU_SMS_MAX_CONCAT_SEGMENT_LEN];
+                                                        ///< User data of each segment
+}
+SmsConcatReassembly_t;
+
+static le_mem_PoolRef_t SmsConcatReassemblyPool;
+static le_dls_List_t SmsConcatReassemblies = LE_DLS_LIST_INIT;  ///< Oldest first
+static uint32_t SmsConcatReassemblyCnt = 0;
+
+// Timer giving up the oldest message being reassembled, running while the list is not empty
+static le_timer_Ref_t SmsConcatTimer;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time after which a concatenated message is given up if some of its segments are still missing,
+ * in milliseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SmsConcatTimeoutMs = PA_SIMU_SMS_DEFAULT_CONCAT_TIMEOUT_MS;
+
+// Reference of the next injected concatenated message, if not chosen by the client. Never 0, which
+// means that the server chooses the reference.
+static uint8_t SmsConcatNextReference = 1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the concatenated messages.
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_smsSimu_ConcatStats_t SmsConcatStats;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool and list of the connections to the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SmsServerConnectionPool;
+static le_dls_List_t SmsServerConnections = LE_DLS_LIST_INIT;
+static uint32_t SmsServerConnectionCnt = 0;
+static uint32_t SmsServerConnectionNextId = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of simultaneous connections to the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SmsServerMaxConnections = PA_SIMU_SMS_DEFAULT_MAX_CONN;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of simultaneous connections.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetMaxConnections
+(
+    int32_t value           ///< [IN] Maximum number of connections
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of frames queued on one connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetTxQueueMax
+(
+    int32_t value           ///< [IN] Maximum number of frames
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the fixed part of the delivery delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetDeliveryDelay
+(
+    int32_t value           ///< [IN] Delay in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the random part of the delivery delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetDeliveryJitter
+(
+    int32_t value           ///< [IN] Maximum jitter in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the fixed part of the status report delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatusReportDelay
+(
+    int32_t value           ///< [IN] Delay in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the random part of the status report delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatusReportJitter
+(
+    int32_t value           ///< [IN] Maximum jitter in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the outcomes of the status reports from a string.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatusReportOutcomesFromString
+(
+    const char* valueStr    ///< [IN] Comma-separated 'status:weight' list
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of entries of the cell broadcast configuration.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetCellBroadcastMax
+(
+    int32_t value           ///< [IN] Maximum number of entries
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the reassembly timeout of the concatenated messages.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetConcatTimeout
+(
+    int32_t value           ///< [IN] Timeout in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of messages the SIM storage can hold.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSimCapacity
+(
+    int32_t value           ///< [IN] Number of messages
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file backing the SIM storage.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSimFileFromString
+(
+    const char* valueStr    ///< [IN] File path, empty to keep the messages in memory only
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file backing the NV storage.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetNvFileFromString
+(
+    const char* valueStr    ///< [IN] File path, empty to keep the messages in memory only
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the TCP port of the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetPort
+(
+    int32_t value           ///< [IN] Port number, 0 for a port chosen by the system
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the address the TCP socket of the SMS server is bound to.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetBindAddressFromString
+(
+    const char* valueStr    ///< [IN] Host name or numeric address, empty for all addresses
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the Unix domain socket of the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetUnixSocketFromString
+(
+    const char* valueStr    ///< [IN] Socket path, '@' prefix for abstract, empty for TCP
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of messages the NV storage can hold.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetNvCapacity
+(
+    int32_t value           ///< [IN] Number of messages
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Definition of settings that are settable through simuConfig.
+ */
+//--------------------------------------------------------------------------------------------------
+static const simuConfig_Property_t ConfigProperties[] = {
+    { .name = "maxConnections",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetMaxConnections } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_MAX_CONN) },
+    { .name = "txQueueMax",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetTxQueueMax } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_TX_QUEUE_MAX) },
+    { .name = "deliveryDelayMs",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetDeliveryDelay } },
+      .defaultValuePtr = "0" },
+    { .name = "deliveryJitterMs",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetDeliveryJitter } },
+      .defaultValuePtr = "0" },
+    { .name = "statusReportDelayMs",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetStatusReportDelay } },
+      .defaultValuePtr = "0" },
+    { .name = "statusReportJitterMs",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetStatusReportJitter } },
+      .defaultValuePtr = "0" },
+    { .name = "statusReportOutcomes",
+      .setter = { .type = SIMUCONFIG_HANDLER_STRING,
+                  .handler = { .stringFn = SetStatusReportOutcomesFromString } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_SR_STATUS) },
+    { .name = "cbMaxEntries",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetCellBroadcastMax } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_CB_CONFIG_MAX) },
+    { .name = "concatTimeoutMs",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetConcatTimeout } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_CONCAT_TIMEOUT_MS) },
+    { .name = "simCapacity",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetSimCapacity } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_STORAGE_CAPACITY) },
+    { .name = "nvCapacity",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetNvCapacity } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_STORAGE_CAPACITY) },
+    { .name = "simFile",
+      .setter = { .type = SIMUCONFIG_HANDLER_STRING,
+                  .handler = { .stringFn = SetSimFileFromString } },
+      .defaultValuePtr = "" },
+    { .name = "nvFile",
+      .setter = { .type = SIMUCONFIG_HANDLER_STRING,
+                  .handler = { .stringFn = SetNvFileFromString } },
+      .defaultValuePtr = "" },
+    { .name = "port",
+      .setter = { .type = SIMUCONFIG_HANDLER_INT,
+                  .handler = { .intFn = SetPort } },
+      .defaultValuePtr = STRINGIZE(PA_SIMU_SMS_DEFAULT_PORT) },
+    { .name = "bindAddress",
+      .setter = { .type = SIMUCONFIG_HANDLER_STRING,
+                  .handler = { .stringFn = SetBindAddressFromString } },
+      .defaultValuePtr = "" },
+    { .name = "unixSocket",
+      .setter = { .type = SIMUCONFIG_HANDLER_STRING,
+                  .handler = { .stringFn = SetUnixSocketFromString } },
+      .defaultValuePtr = "" },
+    {0}
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Services available for configuration.
+ */
+//--------------------------------------------------------------------------------------------------
+static const simuConfig_Service_t ConfigService = {
+    .namePtr = "sms",
+    .configTreeRootPathPtr = PA_SIMU_CFG_MODEM_ROOT "/sms",
+    .properties = ConfigProperties
+};
+
+/** Memory **/
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Value of a slot index meaning 'no slot'.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_SMS_SIMU_NO_SLOT         UINT32_MAX
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lists of slots kept by a storage bank: the free slots, and the used slots of each status.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum {
+    SMS_SLOT_LIST_FREE,         ///< Free slots
+    SMS_SLOT_LIST_RX_UNREAD,    ///< LE_SMS_RX_UNREAD messages
+    SMS_SLOT_LIST_RX_READ,      ///< LE_SMS_RX_READ messages
+    SMS_SLOT_LIST_SENT,         ///< LE_SMS_STORED_SENT messages
+    SMS_SLOT_LIST_UNSENT,       ///< LE_SMS_STORED_UNSENT messages
+    SMS_SLOT_LIST_OTHER,        ///< Messages with any other status
+    SMS_SLOT_LIST_CNT
+}
+SmsSlotList_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Doubly-linked list of slots, linked through their indexes.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint32_t head;              ///< First slot
+    uint32_t tail;              ///< Last slot
+    uint32_t count;             ///< Number of slots
+}
+SmsSlotListHead_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Message slot of a storage bank.
+ *
+ * A slot is used if it has been allocated in the current generation of its bank and its status is
+ * not LE_SMS_STATUS_UNKNOWN. Every slot below the high-water mark of the bank is linked either in
+ * the free list or in the list of its status.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint32_t generation;        ///< Generation of the bank when the slot was allocated
+    uint32_t prev;              ///< Previous slot in the list of the slot
+    uint32_t next;              ///< Next slot in the list of the slot
+    le_sms_Status_t status;     ///< Message status
+    pa_sms_Protocol_t protocol; ///< Message protocol
+    uint32_t dataLen;           ///< Length of the PDU
+    const uint8_t* dataPtr;     ///< PDU, stored in frameBufferPtr or fileSlotPtr
+    void* frameBufferPtr;       ///< Reference to the frame buffer holding the PDU
+    pa_sms_SimuBankFileSlot_t* fileSlotPtr; ///< Slot of the bank file, NULL if not persistent
+}
+SmsMsgInMemory;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Storage bank (SIM or NV) holding the messages.
+ *
+ * Allocation and release of a slot are done in constant time through the free list. The slots
+ * above the high-water mark have never been allocated in the current generation, so deleting all
+ * the messages only requires to start a new generation.
+ *
+ * If a file is configured for the bank, the messages are also kept in this memory-mapped file so
+ * that they survive a restart. The slots then hold the PDUs in the file instead of frame buffers.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    const char* namePtr;        ///< Name of the bank (for logs)
+    SmsMsgInMemory* slotsPtr;   ///< Array of 'capacity' slots
+    uint32_t capacity;          ///< Number of slots
+    uint32_t newCapacity;       ///< Capacity to apply when the bank is empty
+    uint32_t generation;        ///< Current generation
+    uint32_t highWaterMark;     ///< Slots from this index have not been used in this generation
+    uint32_t usedCnt;           ///< Number of used slots
+    SmsSlotListHead_t lists[SMS_SLOT_LIST_CNT];     ///< Free slots and used slots per status
+    char filePath[PATH_MAX];    ///< File backing the bank, empty if none
+    pa_sms_SimuBankFileHeader_t* fileHeaderPtr;     ///< Mapping of the file, NULL if none
+    size_t fileSize;            ///< Size of the mapping
+}
+SmsStorageBank_t;
+
+#define PA_SMS_SIMU_STORAGE_CNT     PA_SMS_STORAGE_SIM
+
+static SmsStorageBank_t SmsBanks[PA_SMS_SIMU_STORAGE_CNT] = {
+    [PA_SMS_STORAGE_NV - 1] = { .namePtr = "NV",
+                                .newCapacity = PA_SIMU_SMS_DEFAULT_STORAGE_CAPACITY },
+    [PA_SMS_STORAGE_SIM - 1] = { .namePtr = "SIM",
+                                 .newCapacity = PA_SIMU_SMS_DEFAULT_STORAGE_CAPACITY },
+};
+
+static char SmsSmsc[LE_MDMDEFS_PHONE_NUM_MAX_LEN] = PA_SIMU_SMS_DEFAULT_SMSC;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache of the subscriber phone number, invalidated by the SIM module when it changes.
+ */
+//--------------------------------------------------------------------------------------------------
+static char LocalNumber[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
+static le_result_t LocalNumberResult = LE_FAULT;
+static bool LocalNumberValid = false;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the subscriber phone number, cached until the SIM module invalidates it.
+ *
+ * @return The phone number, or NULL if it is not available.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* GetLocalNumber
+(
+    void
+)
+{
+    if (!LocalNumberValid)
+    {
+        LocalNumberResult = pa_sim_GetSubscriberPhoneNumber(LocalNumber, sizeof(LocalNumber));
+        LocalNumberValid = true;
+    }
+
+    return (LE_OK == LocalNumberResult) ? LocalNumber : NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fields of the first octet and of the header of GSM SMS-SUBMIT and SMS-DELIVER (3GPP TS 23.040).
+ */
+//--------------------------------------------------------------------------------------------------
+#define SMS_GSM_MTI_MASK            0x03
+#define SMS_GSM_MTI_DELIVER         0x00
+#define SMS_GSM_MTI_SUBMIT          0x01
+#define SMS_GSM_MTI_STATUS_REPORT   0x02
+#define SMS_GSM_MMS_NO_MORE         0x04
+#define SMS_GSM_VPF_MASK            0x18
+#define SMS_GSM_VPF_NONE            0x00
+#define SMS_GSM_VPF_RELATIVE        0x10
+#define SMS_GSM_SRR                 0x20
+#define SMS_GSM_UDHI                0x40
+#define SMS_GSM_RP                  0x80
+#define SMS_GSM_TON_MASK            0x70
+#define SMS_GSM_TON_INTERNATIONAL   0x10
+#define SMS_GSM_TON_ALPHANUMERIC    0x50
+#define SMS_GSM_SCTS_LEN            7
+#define SMS_GSM_NPI_ISDN            0x01
+#define SMS_GSM_TOA_EXTENSION       0x80
+#define SMS_GSM_MAX_ADDRESS_DIGITS  20
+#define SMS_GSM_MAX_UD_LEN          140
+#define SMS_GSM_MAX_SEPTETS         160
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * User data header of the segments of a concatenated message, with an 8-bit or 16-bit reference.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SMS_GSM_IEI_CONCAT_8BIT     0x00
+#define SMS_GSM_IEI_CONCAT_16BIT    0x08
+#define SMS_GSM_CONCAT_UDH_LEN      6
+
+static uint32_t SmsServerSubmitMessage
+(
+    pa_sms_SimuPdu_t * framePtr         ///< [IN] Message, allocated from a frame buffer pool
+);
+
+static void SmsScheduleDelivery
+(
+    pa_sms_SimuPdu_t * framePtr,        ///< [IN] Message, allocated from a frame buffer pool
+    uint32_t delayMs,                   ///< [IN] Delay before the delivery
+    SmsDeliveryType_t type              ///< [IN] How to deliver the message
+);
+
+static void SmsServerScheduleStatusReport
+(
+    const pa_sms_SimuPdu_t* submitPtr,  ///< [IN] SMS-SUBMIT, with SMSC information
+    uint8_t msgRef,                     ///< [IN] TP-MR of the message
+    uint32_t deliveryDelayMs            ///< [IN] Delay before the delivery of the message
+);
+
+static le_result_t SmsServerHandleCellBroadcast
+(
+    const pa_sms_SimuPdu_t* framePtr    ///< [IN] PA_SIMU_SMS_FRAME_CELL_BROADCAST frame
+);
+
+static le_result_t SmsServerHandleRemoteMessage
+(
+    pa_sms_SimuPdu_t * sourceMsgPtr,                    ///< [IN] Message, allocated from a frame
+                                                        ///  buffer pool
+    pa_sms_NewMessageIndication_t * msgIndicationPtr    ///< [OUT] Reported indication (optional)
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * New message indications of a batch, reported to the new message handler in one go.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint32_t count;                                                         ///< Nb of indications
+    pa_sms_NewMessageIndication_t indications[PA_SIMU_SMS_MAX_BATCH_CNT];   ///< Indications
+}
+SmsNewMsgBatch_t;
+
+static le_mem_PoolRef_t SmsNewMsgBatchPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pools of reference-counted frame buffers.
+ *
+ * Incoming frames are received directly in these buffers, and the stored messages keep a reference
+ * on the buffer holding their PDU instead of a copy of it. PDUs received in a batch are copied to
+ * a PDU frame buffer, so that a stored message never pins a whole batch buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SmsPduFramePool;
+static le_mem_PoolRef_t SmsBatchFramePool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the bytes copied on the receive path.
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_smsSimu_CopyStats_t SmsCopyStats;
+
+pa_sms_StorageMsgHdlrFunc_t StorageMsgHdlr=NULL;
+pa_sms_NewMsgHdlrFunc_t  NewSMSHandler=NULL;
+
+static le_sms_Storage_t PrefSmsStorage;
+
+static int NumberSmsInStorageNone=0;
+static int SmsSendErrorCause;
+static char SMSMessageReference=0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Range of 3GPP cell broadcast message identifiers.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint16_t fromId;
+    uint16_t toId;
+} CellBroadcastRange_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cell broadcast configuration.
+ *
+ * The 3GPP ranges are kept sorted, along with their union as sorted disjoint ranges, so that an
+ * incoming message identifier is filtered by binary search. The 3GPP2 services are kept sorted on
+ * (service category, language) for the same reason.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    CellBroadcastRange_t* rangesPtr;        ///< Configured ranges, sorted by fromId then toId
+    CellBroadcastRange_t* mergedRangesPtr;  ///< Union of the configured ranges
+    uint32_t rangeCnt;                      ///< Number of configured ranges
+    uint32_t mergedRangeCnt;                ///< Number of ranges in the union
+    uint32_t rangeCapacity;                 ///< Allocated entries of the range arrays
+    uint32_t* servicesPtr;                  ///< Configured 3GPP2 services, sorted
+    uint32_t serviceCnt;                    ///< Number of configured 3GPP2 services
+    uint32_t serviceCapacity;               ///< Allocated entries of servicesPtr
+    bool isGwActivated;                     ///< 3GPP cell broadcast activated
+    bool isCdmaActivated;                   ///< 3GPP2 cell broadcast activated
+} CellBroadCast_t;
+
+static CellBroadCast_t CellBroadcastConfig;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of 3GPP ranges, and of 3GPP2 services, in the cell broadcast configuration.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t CellBroadcastConfigMax = PA_SIMU_SMS_DEFAULT_CB_CONFIG_MAX;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the storage bank of a storage.
+ */
+//--------------------------------------------------------------------------------------------------
+static SmsStorageBank_t * GetSmsBank
+(
+    pa_sms_Storage_t    storage     ///< [IN] SMS Storage used
+)
+{
+    if ( (storage != PA_SMS_STORAGE_NV) && (storage != PA_SMS_STORAGE_SIM) )
+    {
+        return NULL;
+    }
+
+    return &SmsBanks[storage-1];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if a slot of a storage bank is used.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsSmsSlotUsed
+(
+    const SmsStorageBank_t* bankPtr,    ///< [IN] Storage bank
+    uint32_t                index       ///< [IN] Index of the slot
+)
+{
+    return (index < bankPtr->highWaterMark) &&
+           (bankPtr->slotsPtr[index].generation == bankPtr->generation) &&
+           (bankPtr->slotsPtr[index].status != LE_SMS_STATUS_UNKNOWN);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get message data in memory.
+ *
+ * @return The message, or NULL if there is no message at this place.
+ */
+//--------------------------------------------------------------------------------------------------
+static SmsMsgInMemory * GetSmsMsg
+(
+    pa_sms_Storage_t    storage,    ///< [IN] SMS Storage used
+    uint32_t            index       ///< [IN] The place of storage in memory.
+)
+{
+    SmsStorageBank_t* bankPtr = GetSmsBank(storage);
+
+    if ( (NULL == bankPtr) || (!IsSmsSlotUsed(bankPtr, index)) )
+    {
+        return NULL;
+    }
+
+    return &bankPtr->slotsPtr[index];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the frame buffer referenced by a slot, if any.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReleaseSmsSlotData
+(
+    SmsMsgInMemory*     slotPtr     ///< [IN] Slot
+)
+{
+    if (NULL != slotPtr->frameBufferPtr)
+    {
+        le_mem_Release(slotPtr->frameBufferPtr);
+        slotPtr->frameBufferPtr = NULL;
+        slotPtr->dataPtr = NULL;
+        slotPtr->dataLen = 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the PDU of a slot, taking a reference on the frame buffer holding it.
+ *
+ * A PDU which is only a part of its frame buffer (i.e. a PDU of a batch) is copied to a PDU frame
+ * buffer of its own.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSmsSlotData
+(
+    SmsMsgInMemory*         slotPtr,        ///< [IN] Slot
+    void*                   frameBufferPtr, ///< [IN] Frame buffer holding the PDU
+    const pa_sms_SimuPdu_t* pduPtr          ///< [IN] PDU, inside the frame buffer
+)
+{
+    if (NULL != slotPtr->fileSlotPtr)
+    {
+        pa_sms_SimuBankFileSlot_t* fileSlotPtr = slotPtr->fileSlotPtr;
+
+        // Persistent bank: the PDU is copied to the file
+        ReleaseSmsSlotData(slotPtr);
+        memcpy(fileSlotPtr->data, pduPtr->data, pduPtr->dataLen);
+        fileSlotPtr->protocol = pduPtr->protocol;
+        fileSlotPtr->dataLen = pduPtr->dataLen;
+        SmsCopyStats.rxCopiedBytes += pduPtr->dataLen;
+
+        slotPtr->protocol = pduPtr->protocol;
+        slotPtr->dataLen = pduPtr->dataLen;
+        slotPtr->dataPtr = fileSlotPtr->data;
+        return;
+    }
+
+    if ((void*)pduPtr != frameBufferPtr)
+    {
+        pa_sms_SimuPdu_t* framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+
+        memcpy(framePtr, pduPtr, sizeof(pa_sms_SimuPdu_t) + pduPtr->dataLen);
+        SmsCopyStats.rxCopiedBytes += pduPtr->dataLen;
+
+        ReleaseSmsSlotData(slotPtr);
+        slotPtr->frameBufferPtr = framePtr;
+        pduPtr = framePtr;
+    }
+    else
+    {
+        le_mem_AddRef(frameBufferPtr);
+        ReleaseSmsSlotData(slotPtr);
+        slotPtr->frameBufferPtr = frameBufferPtr;
+    }
+
+    slotPtr->protocol = pduPtr->protocol;
+    slotPtr->dataLen = pduPtr->dataLen;
+    slotPtr->dataPtr = pduPtr->data;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the list holding the slots with a given status.
+ */
+//--------------------------------------------------------------------------------------------------
+static SmsSlotList_t GetSmsSlotList
+(
+    le_sms_Status_t status      ///< [IN] Status of the message
+)
+{
+    switch (status)
+    {
+        case LE_SMS_RX_UNREAD:
+            return SMS_SLOT_LIST_RX_UNREAD;
+        case LE_SMS_RX_READ:
+            return SMS_SLOT_LIST_RX_READ;
+        case LE_SMS_STORED_SENT:
+            return SMS_SLOT_LIST_SENT;
+        case LE_SMS_STORED_UNSENT:
+            return SMS_SLOT_LIST_UNSENT;
+        case LE_SMS_STATUS_UNKNOWN:
+            return SMS_SLOT_LIST_FREE;
+        default:
+            return SMS_SLOT_LIST_OTHER;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a slot at the tail of a list of a storage bank.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LinkSmsSlot
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    SmsSlotList_t       list,       ///< [IN] List to add the slot to
+    uint32_t            index       ///< [IN] Index of the slot
+)
+{
+    SmsSlotListHead_t* listPtr = &bankPtr->lists[list];
+    SmsMsgInMemory* slotPtr = &bankPtr->slotsPtr[index];
+
+    slotPtr->prev = listPtr->tail;
+    slotPtr->next = PA_SMS_SIMU_NO_SLOT;
+    if (PA_SMS_SIMU_NO_SLOT != listPtr->tail)
+    {
+        bankPtr->slotsPtr[listPtr->tail].next = index;
+    }
+    else
+    {
+        listPtr->head = index;
+    }
+    listPtr->tail = index;
+    listPtr->count++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a slot from a list of a storage bank.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UnlinkSmsSlot
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    SmsSlotList_t       list,       ///< [IN] List holding the slot
+    uint32_t            index       ///< [IN] Index of the slot
+)
+{
+    SmsSlotListHead_t* listPtr = &bankPtr->lists[list];
+    SmsMsgInMemory* slotPtr = &bankPtr->slotsPtr[index];
+
+    if (PA_SMS_SIMU_NO_SLOT != slotPtr->prev)
+    {
+        bankPtr->slotsPtr[slotPtr->prev].next = slotPtr->next;
+    }
+    else
+    {
+        listPtr->head = slotPtr->next;
+    }
+
+    if (PA_SMS_SIMU_NO_SLOT != slotPtr->next)
+    {
+        bankPtr->slotsPtr[slotPtr->next].prev = slotPtr->prev;
+    }
+    else
+    {
+        listPtr->tail = slotPtr->prev;
+    }
+    listPtr->count--;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Change the status of a slot of a storage bank, moving it to the list of its new status.
+ *
+ * Setting LE_SMS_STATUS_UNKNOWN releases the slot.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSmsSlotStatus
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    uint32_t            index,      ///< [IN] Index of the slot
+    le_sms_Status_t     status      ///< [IN] New status
+)
+{
+    SmsMsgInMemory* slotPtr = &bankPtr->slotsPtr[index];
+    SmsSlotList_t oldList = GetSmsSlotList(slotPtr->status);
+    SmsSlotList_t newList = GetSmsSlotList(status);
+
+    slotPtr->status = status;
+    if (NULL != slotPtr->fileSlotPtr)
+    {
+        slotPtr->fileSlotPtr->generation = bankPtr->generation;
+        slotPtr->fileSlotPtr->status = status;
+    }
+
+    if (oldList == newList)
+    {
+        return;
+    }
+
+    UnlinkSmsSlot(bankPtr, oldList, index);
+    LinkSmsSlot(bankPtr, newList, index);
+
+    if (SMS_SLOT_LIST_FREE == oldList)
+    {
+        bankPtr->usedCnt++;
+    }
+    else if (SMS_SLOT_LIST_FREE == newList)
+    {
+        ReleaseSmsSlotData(slotPtr);
+        bankPtr->usedCnt--;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make the slots up to a given index available in the current generation of a storage bank, by
+ * moving the high-water mark and adding the slots it skips to the free list.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RaiseSmsHighWaterMark
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    uint32_t            index       ///< [IN] Index of the slot to make available
+)
+{
+    while (bankPtr->highWaterMark <= index)
+    {
+        SmsMsgInMemory* slotPtr = &bankPtr->slotsPtr[bankPtr->highWaterMark];
+
+        // Data left by a previous generation is released when the slot is reused
+        ReleaseSmsSlotData(slotPtr);
+        slotPtr->generation = bankPtr->generation;
+        slotPtr->status = LE_SMS_STATUS_UNKNOWN;
+        LinkSmsSlot(bankPtr, SMS_SLOT_LIST_FREE, bankPtr->highWaterMark);
+        bankPtr->highWaterMark++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate a slot in a storage bank.
+ *
+ * @return The index of the slot, or PA_SMS_SIMU_NO_SLOT if the bank is full.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t AllocSmsSlot
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    le_sms_Status_t     status      ///< [IN] Status of the message to store
+)
+{
+    uint32_t index = bankPtr->lists[SMS_SLOT_LIST_FREE].head;
+
+    if (PA_SMS_SIMU_NO_SLOT == index)
+    {
+        if (bankPtr->highWaterMark >= bankPtr->capacity)
+        {
+            return PA_SMS_SIMU_NO_SLOT;
+        }
+
+        index = bankPtr->highWaterMark;
+        RaiseSmsHighWaterMark(bankPtr, index);
+    }
+
+    SetSmsSlotStatus(bankPtr, index, status);
+    return index;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate a given slot in a storage bank.
+ *
+ * @return LE_OUT_OF_RANGE The index is beyond the capacity of the bank.
+ * @return LE_DUPLICATE    The slot is already used, its status is updated.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t AllocSmsSlotAt
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    uint32_t            index,      ///< [IN] Index of the slot
+    le_sms_Status_t     status      ///< [IN] Status of the message to store
+)
+{
+    bool isUsed;
+
+    if (index >= bankPtr->capacity)
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    isUsed = IsSmsSlotUsed(bankPtr, index);
+    RaiseSmsHighWaterMark(bankPtr, index);
+    SetSmsSlotStatus(bankPtr, index, status);
+
+    return isUsed ? LE_DUPLICATE : LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Unmap the file backing a storage bank, if any. The slots must be reallocated afterwards.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UnmapSmsBankFile
+(
+    SmsStorageBank_t*   bankPtr     ///< [IN] Storage bank
+)
+{
+    if (NULL != bankPtr->fileHeaderPtr)
+    {
+        munmap(bankPtr->fileHeaderPtr, bankPtr->fileSize);
+        bankPtr->fileHeaderPtr = NULL;
+        bankPtr->fileSize = 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the header of a storage bank file is valid for a file of a given size.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsSmsBankFileValid
+(
+    const pa_sms_SimuBankFileHeader_t*  headerPtr,  ///< [IN] Header read from the file
+    off_t                               fileSize    ///< [IN] Size of the file
+)
+{
+    return (PA_SIMU_SMS_BANK_FILE_MAGIC == headerPtr->magic) &&
+           (PA_SIMU_SMS_BANK_FILE_VERSION == headerPtr->version) &&
+           (sizeof(pa_sms_SimuBankFileSlot_t) == headerPtr->slotSize) &&
+           (0 != headerPtr->capacity) &&
+           (headerPtr->capacity <= PA_SIMU_SMS_MAX_STORAGE_CAPACITY) &&
+           (fileSize == (off_t)(sizeof(pa_sms_SimuBankFileHeader_t) +
+                                (size_t)headerPtr->capacity * sizeof(pa_sms_SimuBankFileSlot_t)));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map the file backing a storage bank.
+ *
+ * The messages of a valid file are kept if requested. Otherwise, the file is recreated empty with
+ * the capacity to apply to the bank.
+ *
+ * @return LE_FAULT        The file could not be mapped.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t MapSmsBankFile
+(
+    SmsStorageBank_t*   bankPtr,        ///< [IN] Storage bank
+    bool                keepContents,   ///< [IN] Keep the messages of a valid file
+    bool*               loadedPtr       ///< [OUT] The messages of the file have been kept
+)
+{
+    pa_sms_SimuBankFileHeader_t header;
+    struct stat fileStat;
+    size_t fileSize;
+    void* mapPtr;
+    int fd;
+
+    *loadedPtr = false;
+
+    fd = open(bankPtr->filePath, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to open %s storage file '%s' (%m)", bankPtr->namePtr, bankPtr->filePath);
+        return LE_FAULT;
+    }
+
+    if (keepContents && (0 == fstat(fd, &fileStat)) &&
+        (sizeof(header) == pread(fd, &header, sizeof(header), 0)) &&
+        IsSmsBankFileValid(&header, fileStat.st_size))
+    {
+        fileSize = fileStat.st_size;
+        *loadedPtr = true;
+    }
+    else
+    {
+        if (keepContents && (0 == fstat(fd, &fileStat)) && (0 != fileStat.st_size))
+        {
+            LE_WARN("Invalid %s storage file '%s', recreated", bankPtr->namePtr,
+                    bankPtr->filePath);
+        }
+
+        // Truncating first makes all the slots free
+        fileSize = sizeof(pa_sms_SimuBankFileHeader_t) +
+                   (size_t)bankPtr->newCapacity * sizeof(pa_sms_SimuBankFileSlot_t);
+        if ((0 != ftruncate(fd, 0)) || (0 != ftruncate(fd, fileSize)))
+        {
+            LE_ERROR("Unable to size %s storage file '%s' (%m)", bankPtr->namePtr,
+                     bankPtr->filePath);
+            close(fd);
+            return LE_FAULT;
+        }
+    }
+
+    mapPtr = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == mapPtr)
+    {
+        LE_ERROR("Unable to map %s storage file '%s' (%m)", bankPtr->namePtr, bankPtr->filePath);
+        return LE_FAULT;
+    }
+
+    bankPtr->fileHeaderPtr = mapPtr;
+    bankPtr->fileSize = fileSize;
+
+    if (!*loadedPtr)
+    {
+        bankPtr->fileHeaderPtr->magic = PA_SIMU_SMS_BANK_FILE_MAGIC;
+        bankPtr->fileHeaderPtr->version = PA_SIMU_SMS_BANK_FILE_VERSION;
+        bankPtr->fileHeaderPtr->capacity = bankPtr->newCapacity;
+        bankPtr->fileHeaderPtr->slotSize = sizeof(pa_sms_SimuBankFileSlot_t);
+        bankPtr->fileHeaderPtr->generation = bankPtr->generation;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate the slots of a storage bank, releasing the previous ones.
+ *
+ * The slots are attached to the slots of the bank file if it is mapped.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AllocSmsBankSlots
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    uint32_t            capacity    ///< [IN] Number of slots
+)
+{
+    uint32_t index;
+
+    for (index = 0; (NULL != bankPtr->slotsPtr) && (index < bankPtr->capacity); index++)
+    {
+        ReleaseSmsSlotData(&bankPtr->slotsPtr[index]);
+    }
+    free(bankPtr->slotsPtr);
+    bankPtr->capacity = capacity;
+    bankPtr->slotsPtr = calloc(bankPtr->capacity, sizeof(SmsMsgInMemory));
+    LE_FATAL_IF(NULL == bankPtr->slotsPtr, "Unable to allocate %u messages for %s storage",
+                bankPtr->capacity, bankPtr->namePtr);
+
+    if (NULL != bankPtr->fileHeaderPtr)
+    {
+        pa_sms_SimuBankFileSlot_t* fileSlotsPtr =
+            (pa_sms_SimuBankFileSlot_t*)(bankPtr->fileHeaderPtr + 1);
+
+        for (index = 0; index < bankPtr->capacity; index++)
+        {
+            bankPtr->slotsPtr[index].fileSlotPtr = &fileSlotsPtr[index];
+        }
+        LE_INFO("%s storage can hold %u messages, stored in '%s'", bankPtr->namePtr,
+                bankPtr->capacity, bankPtr->filePath);
+    }
+    else
+    {
+        LE_INFO("%s storage can hold %u messages", bankPtr->namePtr, bankPtr->capacity);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Empty the lists of a storage bank.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClearSmsBankLists
+(
+    SmsStorageBank_t*   bankPtr     ///< [IN] Storage bank
+)
+{
+    SmsSlotList_t list;
+
+    bankPtr->highWaterMark = 0;
+    bankPtr->usedCnt = 0;
+    for (list = 0; list < SMS_SLOT_LIST_CNT; list++)
+    {
+        bankPtr->lists[list].head = PA_SMS_SIMU_NO_SLOT;
+        bankPtr->lists[list].tail = PA_SMS_SIMU_NO_SLOT;
+        bankPtr->lists[list].count = 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release all the slots of a storage bank.
+ *
+ * The slots are freed by starting a new generation, unless a new capacity has to be applied. Only
+ * the frame buffers referenced by the used slots are released one by one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResetSmsBank
+(
+    SmsStorageBank_t*   bankPtr     ///< [IN] Storage bank
+)
+{
+    SmsSlotList_t list;
+
+    for (list = 0; (NULL != bankPtr->slotsPtr) && (list < SMS_SLOT_LIST_CNT); list++)
+    {
+        uint32_t index;
+
+        if (SMS_SLOT_LIST_FREE == list)
+        {
+            continue;
+        }
+
+        for (index = bankPtr->lists[list].head;
+             PA_SMS_SIMU_NO_SLOT != index;
+             index = bankPtr->slotsPtr[index].next)
+        {
+            ReleaseSmsSlotData(&bankPtr->slotsPtr[index]);
+        }
+    }
+
+    if ((NULL == bankPtr->slotsPtr) || (bankPtr->newCapacity != bankPtr->capacity))
+    {
+        if (NULL != bankPtr->fileHeaderPtr)
+        {
+            bool loaded;
+
+            // Recreate the file with the new capacity
+            UnmapSmsBankFile(bankPtr);
+            if (LE_OK != MapSmsBankFile(bankPtr, false, &loaded))
+            {
+                LE_ERROR("%s storage is not persistent anymore", bankPtr->namePtr);
+            }
+        }
+        AllocSmsBankSlots(bankPtr, bankPtr->newCapacity);
+    }
+
+    bankPtr->generation++;
+    ClearSmsBankLists(bankPtr);
+
+    if (NULL != bankPtr->fileHeaderPtr)
+    {
+        bankPtr->fileHeaderPtr->generation = bankPtr->generation;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rebuild the slots of a storage bank from the messages of its file.
+ *
+ * This is a single pass over the mapped slots, the PDUs are neither parsed nor copied.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadSmsBankFile
+(
+    SmsStorageBank_t*   bankPtr     ///< [IN] Storage bank
+)
+{
+    uint32_t index;
+
+    bankPtr->generation = bankPtr->fileHeaderPtr->generation;
+    ClearSmsBankLists(bankPtr);
+    RaiseSmsHighWaterMark(bankPtr, bankPtr->capacity - 1);
+
+    for (index = 0; index < bankPtr->capacity; index++)
+    {
+        SmsMsgInMemory* slotPtr = &bankPtr->slotsPtr[index];
+        pa_sms_SimuBankFileSlot_t* fileSlotPtr = slotPtr->fileSlotPtr;
+
+        if ((fileSlotPtr->generation != bankPtr->generation) ||
+            (LE_SMS_STATUS_UNKNOWN == fileSlotPtr->status) ||
+            (fileSlotPtr->dataLen > PA_SIMU_SMS_MAX_PDU_DATA_LEN))
+        {
+            continue;
+        }
+
+        slotPtr->protocol = fileSlotPtr->protocol;
+        slotPtr->dataLen = fileSlotPtr->dataLen;
+        slotPtr->dataPtr = fileSlotPtr->data;
+        SetSmsSlotStatus(bankPtr, index, fileSlotPtr->status);
+    }
+
+    LE_INFO("%u messages loaded in %s storage", bankPtr->usedCnt, bankPtr->namePtr);
+    if (bankPtr->newCapacity != bankPtr->capacity)
+    {
+        LE_INFO("%s storage capacity will be %u once empty", bankPtr->namePtr,
+                bankPtr->newCapacity);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up a storage bank: load the messages of its file if one is configured, start empty
+ * otherwise. The messages the bank held are dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitSmsBank
+(
+    SmsStorageBank_t*   bankPtr     ///< [IN] Storage bank
+)
+{
+    bool loaded = false;
+
+    UnmapSmsBankFile(bankPtr);
+
+    if (('\0' != bankPtr->filePath[0]) && (LE_OK != MapSmsBankFile(bankPtr, true, &loaded)))
+    {
+        LE_ERROR("%s storage is not persistent", bankPtr->namePtr);
+    }
+
+    if (NULL != bankPtr->fileHeaderPtr)
+    {
+        AllocSmsBankSlots(bankPtr, bankPtr->fileHeaderPtr->capacity);
+    }
+    else
+    {
+        AllocSmsBankSlots(bankPtr, bankPtr->newCapacity);
+    }
+
+    if (loaded)
+    {
+        LoadSmsBankFile(bankPtr);
+    }
+    else
+    {
+        ResetSmsBank(bankPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the capacity of a storage bank.
+ *
+ * The capacity is changed right away if the bank is empty, otherwise when all its messages are
+ * deleted.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSmsBankCapacity
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    int32_t             value       ///< [IN] Number of messages
+)
+{
+    if ((value < 1) || (value > PA_SIMU_SMS_MAX_STORAGE_CAPACITY))
+    {
+        LE_ERROR("Invalid %s storage capacity %d", bankPtr->namePtr, value);
+        return;
+    }
+
+    bankPtr->newCapacity = value;
+
+    if ((NULL != bankPtr->slotsPtr) && (0 == bankPtr->usedCnt))
+    {
+        ResetSmsBank(bankPtr);
+    }
+    else if (bankPtr->newCapacity != bankPtr->capacity)
+    {
+        LE_INFO("%s storage capacity will be %u once empty", bankPtr->namePtr,
+                bankPtr->newCapacity);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of messages the SIM storage can hold.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSimCapacity
+(
+    int32_t value           ///< [IN] Number of messages
+)
+{
+    SetSmsBankCapacity(GetSmsBank(PA_SMS_STORAGE_SIM), value);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of messages the NV storage can hold.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetNvCapacity
+(
+    int32_t value           ///< [IN] Number of messages
+)
+{
+    SetSmsBankCapacity(GetSmsBank(PA_SMS_STORAGE_NV), value);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file backing a storage bank from a string.
+ *
+ * Once the storage is initialized, the messages of the bank are replaced by the ones of the new
+ * file, or dropped if the file is removed from the configuration.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSmsBankFileFromString
+(
+    SmsStorageBank_t*   bankPtr,    ///< [IN] Storage bank
+    const char*         valueStr    ///< [IN] File path, empty to keep the messages in memory only
+)
+{
+    if (0 == strcmp(valueStr, bankPtr->filePath))
+    {
+        return;
+    }
+
+    if (LE_OK != le_utf8_Copy(bankPtr->filePath, valueStr, sizeof(bankPtr->filePath), NULL))
+    {
+        LE_ERROR("%s storage file path '%s' too long", bankPtr->namePtr, valueStr);
+        bankPtr->filePath[0] = '\0';
+    }
+
+    if (NULL != bankPtr->slotsPtr)
+    {
+        InitSmsBank(bankPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file backing the SIM storage.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSimFileFromString
+(
+    const char* valueStr    ///< [IN] File path, empty to keep the messages in memory only
+)
+{
+    SetSmsBankFileFromString(GetSmsBank(PA_SMS_STORAGE_SIM), valueStr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file backing the NV storage.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetNvFileFromString
+(
+    const char* valueStr    ///< [IN] File path, empty to keep the messages in memory only
+)
+{
+    SetSmsBankFileFromString(GetSmsBank(PA_SMS_STORAGE_NV), valueStr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the message bank where incoming message should be stored.
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_sms_Storage_t GetCurrentIncomingStorage
+(
+    void
+)
+{
+    le_result_t res;
+    le_mrc_Rat_t rat;
+
+    res = pa_mrc_GetRadioAccessTechInUse(&rat);
+    if (LE_OK != res)
+    {
+        return PA_SMS_STORAGE_SIM;
+    }
+
+    if (LE_MRC_RAT_CDMA == rat)
+    {
+        return PA_SMS_STORAGE_NV;
+    }
+
+    return PA_SMS_STORAGE_SIM;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function is called to set the preferred SMS storage area.
+ *
+ * @return LE_FAULT         The function failed.
+ * @return LE_OK            The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_SetPreferredStorage
+(
+    le_sms_Storage_t prefStorage  ///< [IN] The preferred SMS storage area
+)
+{
+    if ((prefStorage != LE_SMS_STORAGE_SIM) && (prefStorage != LE_SMS_STORAGE_NV))
+    {
+        return LE_FAULT;
+    }
+
+    PrefSmsStorage = prefStorage;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function is called to get the preferred SMS storage area.
+ *
+ * @return LE_OK            The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_GetPreferredStorage
+(
+    le_sms_Storage_t* prefStoragePtr  ///< [OUT] The preferred SMS storage area
+)
+{
+    *prefStoragePtr = PrefSmsStorage;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to register a handler for a new message reception handling.
+ *
+ * @return LE_OK            The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_SetNewMsgHandler
+(
+    pa_sms_NewMsgHdlrFunc_t msgHandler   ///< [IN] The handler function to handle a new message
+                                         ///       reception.
+)
+{
+    NewSMSHandler = msgHandler;
+
+    NewSMSHandlerRef = le_event_AddHandler("NewSMSHandler",
+                                         EventNewSmsId,
+                                         (le_event_HandlerFunc_t) msgHandler);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to unregister the handler for a new message reception handling.
+ *
+ * @return LE_OK            The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_ClearNewMsgHandler
+(
+    void
+)
+{
+    le_event_RemoveHandler(NewSMSHandlerRef);
+    NewSMSHandlerRef = NULL;
+    NewSMSHandler = NULL;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the new SMS to be received in storage
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_sms_SetSmsInStorage
+(
+   pa_sms_NewMessageIndication_t* msgPtr
+)
+{
+    uint32_t i;
+    int storageIdx = msgPtr->storage;
+    uint32_t index = msgPtr->msgIndex;
+    SmsMsgInMemory* storageMsgPtr = NULL;
+
+    if ((storageIdx == PA_SMS_STORAGE_NV) || (storageIdx == PA_SMS_STORAGE_SIM))
+    {
+        SmsStorageBank_t* bankPtr = GetSmsBank(storageIdx);
+
+        if (LE_OUT_OF_RANGE == AllocSmsSlotAt(bankPtr, index, LE_SMS_RX_UNREAD))
+        {
+            LE_ERROR("Index %u out of %s storage capacity", index, bankPtr->namePtr);
+            return;
+        }
+
+        LE_DEBUG("%u messages in %s storage", bankPtr->usedCnt, bankPtr->namePtr);
+        storageMsgPtr = &bankPtr->slotsPtr[index];
+    }
+    else if (storageIdx == PA_SMS_STORAGE_NONE)
+    {
+        NumberSmsInStorageNone++;
+        LE_DEBUG("NumberSmsInStorageNone %d ", NumberSmsInStorageNone);
+    }
+    else
+    {
+        LE_FATAL("Unknown storage index %d", msgPtr->storage);
+    }
+
+    if(storageMsgPtr)
+    {
+        pa_sms_SimuPdu_t* framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+
+        memset(framePtr, 0, sizeof(pa_sms_SimuPdu_t));
+        framePtr->protocol = msgPtr->protocol;
+        framePtr->dataLen = msgPtr->pduLen;
+        for (i=0; i< msgPtr->pduLen; i++)
+        {
+            framePtr->data[i] = msgPtr->pduCB[i];
+        }
+        SmsCopyStats.rxCopiedBytes += msgPtr->pduLen;
+
+        SetSmsSlotData(storageMsgPtr, framePtr, framePtr);
+        le_mem_Release(framePtr);
+    }
+
+    NewSMSHandler(msgPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the error code
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_sms_SetSmsErrCause
+(
+   int errorCode
+)
+{
+    SmsSendErrorCause = errorCode;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the type of storage in case of full storage indication
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_sms_SetFullStorageType
+(
+    int storage_type
+)
+{
+    // Init the data for the event report
+    pa_sms_StorageStatusInd_t storageStatus;
+    memset(&storageStatus, 0, sizeof(pa_sms_StorageStatusInd_t));
+
+    switch(storage_type)
+    {
+        case SIMU_SMS_STORAGE_NV:
+        {
+            storageStatus.storage = PA_SMS_STORAGE_NV;
+        }
+        break;
+
+        case SIMU_SMS_STORAGE_SIM:
+        {
+            storageStatus.storage = PA_SMS_STORAGE_SIM;
+        }
+        break;
+
+        default:
+        {
+            storageStatus.storage = PA_SMS_STORAGE_UNKNOWN;
+        }
+    }
+    StorageMsgHdlr(&storageStatus);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ *
+ * This function is used to add a status SMS storage notification handler
+ *
+ * @return A handler reference, which is only needed for later removal of the handler.
+ */
+//--------------------------------------------------------------------------------------------------
+le_event_HandlerRef_t pa_sms_AddStorageStatusHandler
+(
+    pa_sms_StorageMsgHdlrFunc_t statusHandler   ///< [IN] The handler function to handle a status
+                                                ///  notification reception.
+)
+{
+    // event mechanism is not used because le_event_RunLoop isn't reached
+    StorageMsgHdlr = statusHandler;
+
+    return (le_event_HandlerRef_t) StorageMsgHdlr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function is called to unregister from a storage message notification handler.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_sms_RemoveStorageStatusHandler
+(
+    le_event_HandlerRef_t storageHandler
+)
+{
+    le_event_RemoveHandler(storageHandler);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function sends a message in PDU mode.
+ *
+ * @return LE_OK              The function succeeded.
+ * @return LE_FAULT           The function failed to send a message in PDU mode.
+ * @return LE_TIMEOUT         No response was received from the Modem.
+ * @return a positive value   The function succeeded. The value represents the message reference.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_SendPduMsg
+(
+    pa_sms_Protocol_t        protocol,   ///< [IN] protocol to use
+    uint32_t                 length,     ///< [IN] The length of the TP data unit in bytes.
+    const uint8_t*           dataPtr,    ///< [IN] The message.
+    uint8_t*                 msgRef,     ///< [OUT] Message reference (TP-MR)
+    uint32_t                 timeout,    ///< [IN] Timeout in seconds.
+    pa_sms_SendingErrCode_t* errorCode   ///< [OUT] The error code.
+)
+{
+    pa_sms_SimuPdu_t* framePtr;
+    uint32_t deliveryDelayMs;
+
+    if (!mrc_simu_IsOnline())
+    {
+        LE_WARN("Not sending message because we're offline.");
+        return LE_FAULT;
+    }
+
+    LE_INFO("Sending PDU message (length=%u protocol=%u)", length, protocol);
+
+    if (length > PA_SIMU_SMS_MAX_PDU_DATA_LEN)
+    {
+        LE_WARN("PDU message is too big");
+        return LE_OUT_OF_RANGE;
+    }
+
+    framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+    framePtr->protocol = protocol;
+
+    LE_FATAL_IF(NULL == GetLocalNumber(), "Unable to get subscriber phone number.");
+    le_utf8_Copy((char *)framePtr->origAddress, GetLocalNumber(), LE_MDMDEFS_PHONE_NUM_MAX_LEN,
+                 NULL);
+
+    framePtr->destAddress[0] = '\0';
+
+    framePtr->dataLen = length;
+    memcpy(framePtr->data, dataPtr, length);
+
+    LE_INFO("SmsSendErrorCause %d", SmsSendErrorCause);
+
+    // Delivered to the clients and to self later on, the TP-MR is returned right away. The frame is
+    // kept until its status report is built, the report is queued after the message.
+    le_mem_AddRef(framePtr);
+    deliveryDelayMs = SmsServerSubmitMessage(framePtr);
+
+    if (LE_OK == SmsSendErrorCause)
+    {
+        SmsServerScheduleStatusReport(framePtr, SMSMessageReference, deliveryDelayMs);
+    }
+    le_mem_Release(framePtr);
+
+    *msgRef = SMSMessageReference;
+
+    // Increment the Message reference (TP-MR).
+    SMSMessageReference++;
+
+    // error cause
+    return  SmsSendErrorCause;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function gets the message from the preferred message storage.
+ *
+ * @return LE_FAULT        The function failed to get the message from the preferred message
+ *                         storage.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_RdPDUMsgFromMem
+(
+    uint32_t            index,      ///< [IN]  The place of storage in memory.
+    pa_sms_Protocol_t   protocol,   ///< [IN] The protocol used for this message
+    pa_sms_Storage_t    storage,    ///< [IN] SMS Storage used
+    pa_sms_Pdu_t*       msgPtr      ///< [OUT] The message.
+)
+{
+    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
+
+    if (NULL == smsMsgPtr)
+    {
+        LE_ERROR("Trying to access invalid SMS storage storage[%u] index[%u]", storage, index);
+        return LE_FAULT;
+    }
+
+    // Only copy of the PDU between its reception and the caller
+    msgPtr->status = smsMsgPtr->status;
+    msgPtr->protocol = smsMsgPtr->protocol;
+    msgPtr->dataLen = smsMsgPtr->dataLen;
+    memcpy(msgPtr->data, smsMsgPtr->dataPtr, smsMsgPtr->dataLen);
+
+    SmsCopyStats.readMsgCnt++;
+    SmsCopyStats.readCopiedBytes += smsMsgPtr->dataLen;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function gets the indexes of messages stored in the preferred memory for a specific
+ * status.
+ *
+ * @return LE_OK             The function succeeded.
+ * @return LE_OVERFLOW       More than PA_SIMU_SMS_MAX_LIST_CNT messages match: only the first
+ *                           PA_SIMU_SMS_MAX_LIST_CNT indexes of the list are returned.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_ListMsgFromMem
+(
+    le_sms_Status_t     status,     ///< [IN] The status of message in memory.
+    pa_sms_Protocol_t   protocol,   ///< [IN] The protocol to read
+    uint32_t           *numPtr,     ///< [OUT] The number of indexes retrieved.
+    uint32_t           *idxPtr,     ///< [OUT] The pointer to an array of indexes.
+                                    ///        The array is filled with 'num' index values.
+    pa_sms_Storage_t    storage     ///< [IN] SMS Storage used
+)
+{
+    SmsStorageBank_t* bankPtr = GetSmsBank(storage);
+
+    *numPtr = 0;
+
+    if (NULL != bankPtr)
+    {
+        SmsSlotList_t list = GetSmsSlotList(status);
+        uint32_t index;
+
+        if ((SMS_SLOT_LIST_FREE == list) || (SMS_SLOT_LIST_OTHER == list))
+        {
+            return LE_OK;
+        }
+
+        // The index array of the caller is limited: every listing starts at the head of the list,
+        // and a larger list is reported as a partial result.
+        index = bankPtr->lists[list].head;
+        while ((PA_SMS_SIMU_NO_SLOT != index) && (*numPtr < PA_SIMU_SMS_MAX_LIST_CNT))
+        {
+            idxPtr[(*numPtr)++] = index;
+            index = bankPtr->slotsPtr[index].next;
+        }
+
+        if (PA_SMS_SIMU_NO_SLOT != index)
+        {
+            SmsCopyStats.listPartialCnt++;
+            LE_WARN("%u messages with status %d in %s storage, only %u listed",
+                    bankPtr->lists[list].count, status, bankPtr->namePtr, *numPtr);
+            return LE_OVERFLOW;
+        }
+
+        LE_DEBUG("%u messages with status %d in %s storage", *numPtr, status, bankPtr->namePtr);
+    }
+    else if (storage == PA_SMS_STORAGE_NONE)
+    {
+        if (status == LE_SMS_RX_UNREAD)
+        {
+            *numPtr = NumberSmsInStorageNone;
+            LE_DEBUG("NumberSmsInStorageNone %d ",NumberSmsInStorageNone);
+        }
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function deletes one specific Message from preferred message storage.
+ *
+ * @return LE_FAULT          The function failed to delete one specific Message from preferred
+ *                           message storage.
+ * @return LE_OK             The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_DelMsgFromMem
+(
+    uint32_t            index,    ///< [IN] Index of the message to be deleted.
+    pa_sms_Protocol_t   protocol, ///< [IN] protocol
+    pa_sms_Storage_t    storage   ///< [IN] SMS Storage used
+)
+{
+    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
+
+    LE_DEBUG("Deleting message storage[%u] index[%u]", storage, index);
+
+    if (NULL == smsMsgPtr)
+    {
+        return LE_FAULT;
+    }
+
+    SmsStorageBank_t* bankPtr = GetSmsBank(storage);
+
+    SetSmsSlotStatus(bankPtr, index, LE_SMS_STATUS_UNKNOWN);
+
+    // A capacity change waiting for the bank to be empty can now be applied
+    if ((0 == bankPtr->usedCnt) && (bankPtr->newCapacity != bankPtr->capacity))
+    {
+        ResetSmsBank(bankPtr);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function deletes all Messages from preferred message storage.
+ *
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_DelAllMsg
+(
+    void
+)
+{
+    pa_sms_Storage_t storage;
+
+    for(storage = PA_SMS_STORAGE_NV; storage <= PA_SMS_STORAGE_SIM; storage++)
+    {
+        ResetSmsBank(GetSmsBank(storage));
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function changes the message status.
+ *
+ * @return LE_FAULT        The function failed.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_ChangeMessageStatus
+(
+    uint32_t            index,    ///< [IN] Index of the message to be deleted.
+    pa_sms_Protocol_t   protocol, ///< [IN] protocol
+    le_sms_Status_t     status,   ///< [IN] The status of message in memory.
+    pa_sms_Storage_t    storage   ///< [IN] SMS Storage used
+)
+{
+    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
+
+    if (NULL == smsMsgPtr)
+    {
+        return LE_FAULT;
+    }
+
+    LE_DEBUG("Changing message status storage[%u] index[%u] status [%u] -> [%u]",
+        storage, index, smsMsgPtr->status, status);
+
+    SetSmsSlotStatus(GetSmsBank(storage), index, status);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to get the SMS center.
+ *
+ * @return
+ *   - LE_FAULT        The function failed.
+ *   - LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_GetSmsc
+(
+    char*        smscPtr,  ///< [OUT] The Short message service center string.
+    size_t       len       ///< [IN] The length of SMSC string.
+)
+{
+    return le_utf8_Copy(smscPtr, SmsSmsc, len, NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to set the SMS center.
+ *
+ * @return LE_FAULT        The function failed.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_sms_SetSmsc
+(
+    const char*    smscPtr  ///< [IN] The Short message service center.
+)
+{
+    return le_utf8_Copy(SmsSmsc, smscPtr, sizeof(SmsSmsc), NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Store a message originating from the simulated world, and fill the indication to report for it.
+ *
+ * A single PDU frame is not copied: the storage keeps a reference on the frame buffer holding it.
+ *
+ * @return LE_NO_MEMORY    There is no more memory available to handle this message.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerStoreRemoteMessage
+(
+    void * frameBufferPtr,                              ///< [IN] Frame buffer holding the message
+    pa_sms_SimuPdu_t * sourceMsgPtr,                    ///< [IN] Message to store
+    pa_sms_NewMessageIndication_t * msgIndicationPtr    ///< [OUT] Indication to report
+)
+{
+    uint32_t idx;
+    SmsMsgInMemory * messageMemPtr = NULL; // Message stored in memory
+    pa_sms_Storage_t storage = GetCurrentIncomingStorage();
+
+    /* Allocate a free spot in memory */
+    idx = AllocSmsSlot(GetSmsBank(storage), LE_SMS_RX_UNREAD);
+    if(idx == PA_SMS_SIMU_NO_SLOT)
+    {
+        LE_WARN("No more spot available in memory to store this message.");
+        return LE_NO_MEMORY;
+    }
+
+    messageMemPtr = &GetSmsBank(storage)->slotsPtr[idx];
+
+    LE_DEBUG("New message at storage[%u] idx[%u] (%p)", storage, idx, messageMemPtr);
+
+    /* Store message */
+    SetSmsSlotData(messageMemPtr, frameBufferPtr, sourceMsgPtr);
+    SmsCopyStats.rxMsgCnt++;
+
+    /* Init the data for the event report */
+    memset(msgIndicationPtr, 0, sizeof(pa_sms_NewMessageIndication_t));
+    msgIndicationPtr->msgIndex = idx;
+    msgIndicationPtr->storage = storage;
+    msgIndicationPtr->protocol = sourceMsgPtr->protocol;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function handle messages originating from the simulated world.
+ *
+ * @return LE_NO_MEMORY    There is no more memory available to handle this message.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerHandleRemoteMessage
+(
+    pa_sms_SimuPdu_t * sourceMsgPtr,                    ///< [IN] Message, allocated from a frame
+                                                        ///  buffer pool
+    pa_sms_NewMessageIndication_t * msgIndicationPtr    ///< [OUT] Reported indication (optional)
+)
+{
+    pa_sms_NewMessageIndication_t msgIndication;
+    le_result_t res;
+
+    res = SmsServerStoreRemoteMessage(sourceMsgPtr, sourceMsgPtr, &msgIndication);
+    if (LE_OK != res)
+    {
+        return res;
+    }
+
+    /* Report index */
+    le_event_Report(EventNewSmsId, &msgIndication, sizeof(msgIndication));
+
+    if (NULL != msgIndicationPtr)
+    {
+        *msgIndicationPtr = msgIndication;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the new message indications of a batch to the new message handler.
+ *
+ * This is queued once per batch instead of reporting one event per message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsDispatchNewMsgBatch
+(
+    void* param1Ptr,    ///< [IN] Batch of indications
+    void* param2Ptr     ///< [IN] Unused
+)
+{
+    SmsNewMsgBatch_t* batchPtr = param1Ptr;
+    uint32_t i;
+
+    for (i = 0; (i < batchPtr->count) && (NULL != NewSMSHandlerRef); i++)
+    {
+        NewSMSHandler(&(batchPtr->indications[i]));
+    }
+
+    le_mem_Release(batchPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the first frame queued on a connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerPopTxFrame
+(
+    SmsServerConnection_t* connPtr      ///< [IN] Connection
+)
+{
+    le_dls_Link_t* linkPtr = le_dls_Pop(&connPtr->txQueue);
+    SmsServerTxEntry_t* entryPtr = CONTAINER_OF(linkPtr, SmsServerTxEntry_t, link);
+
+    le_mem_Release(entryPtr->framePtr);
+    le_mem_Release(entryPtr);
+    connPtr->txQueueCnt--;
+    connPtr->txOffset = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the frames queued on a connection until the socket would block.
+ *
+ * POLLOUT is monitored as long as frames remain in the queue.
+ *
+ * @return LE_FAULT        The socket is in error.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerFlush
+(
+    SmsServerConnection_t* connPtr      ///< [IN] Connection
+)
+{
+    le_dls_Link_t* linkPtr;
+
+    while (NULL != (linkPtr = le_dls_Peek(&connPtr->txQueue)))
+    {
+        SmsServerTxEntry_t* entryPtr = CONTAINER_OF(linkPtr, SmsServerTxEntry_t, link);
+        size_t frameLen = sizeof(pa_sms_SimuPdu_t) + entryPtr->framePtr->dataLen;
+        ssize_t writeSz;
+
+        writeSz = send(connPtr->fd,
+                       (uint8_t*)entryPtr->framePtr + connPtr->txOffset,
+                       frameLen - connPtr->txOffset,
+                       MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (writeSz < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                le_fdMonitor_Enable(connPtr->fdMonitorRef, POLLOUT);
+                return LE_OK;
+            }
+
+            LE_ERROR("Error while send message to conn[%u] fd=%d: %m", connPtr->id, connPtr->fd);
+            return LE_FAULT;
+        }
+
+        connPtr->txOffset += writeSz;
+        if (connPtr->txOffset == frameLen)
+        {
+            SmsServerPopTxFrame(connPtr);
+            connPtr->txMsgCnt++;
+            SmsTxStats.sentCnt++;
+        }
+    }
+
+    le_fdMonitor_Disable(connPtr->fdMonitorRef, POLLOUT);
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop the frames queued on a connection which failed. The connection is closed from its fd
+ * monitor, as it may be in use by the caller.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerFailConnection
+(
+    SmsServerConnection_t* connPtr      ///< [IN] Connection
+)
+{
+    connPtr->txFailed = true;
+
+    while (connPtr->txQueueCnt > 0)
+    {
+        SmsServerPopTxFrame(connPtr);
+        SmsTxStats.failedCnt++;
+    }
+
+    // A socket in error is reported writable, the monitor is then called right away.
+    le_fdMonitor_Enable(connPtr->fdMonitorRef, POLLOUT);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a frame to one connection, without blocking.
+ *
+ * The frame is queued with a new reference and written as soon as the socket accepts it. It is
+ * dropped if the queue of the connection is full.
+ *
+ * @return LE_OVERFLOW     The queue of the connection is full.
+ * @return LE_FAULT        The connection is in error.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerSendFrame
+(
+    SmsServerConnection_t* connPtr,     ///< [IN] Connection to send the frame to
+    pa_sms_SimuPdu_t* framePtr          ///< [IN] Frame to send, allocated from a frame buffer pool
+)
+{
+    SmsServerTxEntry_t* entryPtr;
+
+    if (connPtr->txFailed)
+    {
+        SmsTxStats.failedCnt++;
+        return LE_FAULT;
+    }
+
+    if (connPtr->txQueueCnt >= SmsServerTxQueueMax)
+    {
+        LE_DEBUG("Queue of conn[%u] is full, frame dropped", connPtr->id);
+        connPtr->txDropCnt++;
+        SmsTxStats.droppedCnt++;
+        return LE_OVERFLOW;
+    }
+
+    le_mem_AddRef(framePtr);
+    entryPtr = le_mem_ForceAlloc(SmsServerTxEntryPool);
+    entryPtr->link = LE_DLS_LINK_INIT;
+    entryPtr->framePtr = framePtr;
+    le_dls_Queue(&connPtr->txQueue, &entryPtr->link);
+    connPtr->txQueueCnt++;
+    SmsTxStats.queuedCnt++;
+
+    // Otherwise, the queue is already waiting for POLLOUT
+    if (1 == connPtr->txQueueCnt)
+    {
+        if (LE_OK != SmsServerFlush(connPtr))
+        {
+            SmsServerFailConnection(connPtr);
+            return LE_FAULT;
+        }
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a GSM address field (length, type of address, semi-octets) into a phone number.
+ *
+ * @return LE_FORMAT_ERROR The address is not a phone number (e.g. alphanumeric).
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DecodeGsmAddress
+(
+    const uint8_t* addressPtr,  ///< [IN] Address field
+    char* numberPtr,            ///< [OUT] Phone number
+    size_t numberSize           ///< [IN] Size of numberPtr
+)
+{
+    static const char digits[] = "0123456789*#abc";
+    uint8_t digitCnt = addressPtr[0];
+    uint8_t typeOfNumber = addressPtr[1] & SMS_GSM_TON_MASK;
+    size_t pos = 0;
+    uint8_t i;
+
+    if ((SMS_GSM_TON_ALPHANUMERIC == typeOfNumber) ||
+        ((digitCnt + 2U) > numberSize))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (SMS_GSM_TON_INTERNATIONAL == typeOfNumber)
+    {
+        numberPtr[pos++] = '+';
+    }
+
+    for (i = 0; i < digitCnt; i++)
+    {
+        uint8_t digit = addressPtr[2 + (i / 2)];
+
+        digit = (i & 1) ? (digit >> 4) : (digit & 0x0F);
+        if (digit >= (sizeof(digits) - 1))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        numberPtr[pos++] = digits[digit];
+    }
+    numberPtr[pos] = '\0';
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a decimal value between 0 and 99 in swapped semi-octets.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t EncodeGsmSemiOctets
+(
+    int value   ///< [IN] Value
+)
+{
+    return (uint8_t)(((value % 10) << 4) | ((value / 10) % 10));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a local time as a GSM time stamp (TP-SCTS, TP-DT).
+ */
+//--------------------------------------------------------------------------------------------------
+static void EncodeGsmTimestamp
+(
+    time_t timestamp,       ///< [IN] Time to encode
+    uint8_t* timestampPtr   ///< [OUT] Time stamp, SMS_GSM_SCTS_LEN bytes
+)
+{
+    struct tm localTime;
+    long quarters;
+
+    localtime_r(&timestamp, &localTime);
+    quarters = localTime.tm_gmtoff / (15 * 60);
+
+    timestampPtr[0] = EncodeGsmSemiOctets(localTime.tm_year % 100);
+    timestampPtr[1] = EncodeGsmSemiOctets(localTime.tm_mon + 1);
+    timestampPtr[2] = EncodeGsmSemiOctets(localTime.tm_mday);
+    timestampPtr[3] = EncodeGsmSemiOctets(localTime.tm_hour);
+    timestampPtr[4] = EncodeGsmSemiOctets(localTime.tm_min);
+    timestampPtr[5] = EncodeGsmSemiOctets(localTime.tm_sec);
+    timestampPtr[6] = EncodeGsmSemiOctets(labs(quarters)) | ((quarters < 0) ? 0x08 : 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Positions of the fields of a GSM SMS-SUBMIT.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint32_t smscLen;           ///< Length of the SMSC information
+    uint8_t firstOctet;         ///< First octet of the TPDU
+    uint32_t addressPos;        ///< Position of TP-DA
+    uint32_t addressLen;        ///< Length of TP-DA
+    uint32_t pidPos;            ///< Position of TP-PID, followed by TP-DCS
+    uint32_t udPos;             ///< Position of TP-UDL, followed by TP-UD
+}
+SmsGsmSubmit_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Locate the fields of a GSM SMS-SUBMIT, up to its user data length.
+ *
+ * @return LE_FORMAT_ERROR The PDU is not a valid SMS-SUBMIT.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseGsmSubmit
+(
+    const pa_sms_SimuPdu_t* submitPtr,  ///< [IN] SMS-SUBMIT, with SMSC information
+    SmsGsmSubmit_t* fieldsPtr           ///< [OUT] Positions of the fields
+)
+{
+    const uint8_t* inPtr = submitPtr->data;
+    uint32_t inLen = submitPtr->dataLen;
+    uint32_t vpLen;
+
+    // SMSC information, first octet, TP-MR, then TP-DA length and type of address
+    if (inLen < 1)
+    {
+        return LE_FORMAT_ERROR;
+    }
+    fieldsPtr->smscLen = 1 + inPtr[0];
+    fieldsPtr->addressPos = fieldsPtr->smscLen + 2;
+    if ((fieldsPtr->addressPos + 2) > inLen)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    fieldsPtr->firstOctet = inPtr[fieldsPtr->smscLen];
+    if (SMS_GSM_MTI_SUBMIT != (fieldsPtr->firstOctet & SMS_GSM_MTI_MASK))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    fieldsPtr->addressLen = 2 + ((inPtr[fieldsPtr->addressPos] + 1) / 2);
+    fieldsPtr->pidPos = fieldsPtr->addressPos + fieldsPtr->addressLen;
+
+    switch (fieldsPtr->firstOctet & SMS_GSM_VPF_MASK)
+    {
+        case SMS_GSM_VPF_NONE:
+            vpLen = 0;
+            break;
+        case SMS_GSM_VPF_RELATIVE:
+            vpLen = 1;
+            break;
+        default:
+            vpLen = 7;
+            break;
+    }
+
+    // TP-PID, TP-DCS, TP-VP then at least TP-UDL
+    fieldsPtr->udPos = fieldsPtr->pidPos + 2 + vpLen;
+    if (fieldsPtr->udPos >= inLen)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a GSM SMS-SUBMIT sent to the local number, by rewriting it in place into an SMS-DELIVER.
+ *
+ * Only the header differs between both: the first octet is rewritten, TP-MR and TP-VP are dropped,
+ * TP-DA becomes TP-OA and TP-SCTS is inserted. TP-PID, TP-DCS and the user data (with its header,
+ * if any) are copied as is, so the PDU is never decoded nor encoded.
+ *
+ * @return LE_FORMAT_ERROR The PDU is not a valid SMS-SUBMIT.
+ * @return LE_NOT_FOUND    The message is not sent to the local number.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerLoopbackGsm
+(
+    const pa_sms_SimuPdu_t* submitPtr,  ///< [IN] SMS-SUBMIT, with SMSC information
+    const char* localNumberPtr          ///< [IN] Local number
+)
+{
+    const uint8_t* inPtr = submitPtr->data;
+    uint32_t inLen = submitPtr->dataLen;
+    char destNumber[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
+    pa_sms_SimuPdu_t* framePtr;
+    uint8_t* outPtr;
+    SmsGsmSubmit_t fields;
+
+    if (LE_OK != ParseGsmSubmit(submitPtr, &fields))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (LE_OK != DecodeGsmAddress(&inPtr[fields.addressPos], destNumber, sizeof(destNumber)))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (0 != strncmp(destNumber, localNumberPtr, LE_MDMDEFS_PHONE_NUM_MAX_LEN))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    if ((fields.smscLen + 1 + fields.addressLen + 2 + SMS_GSM_SCTS_LEN +
+         (inLen - fields.udPos)) > PA_SIMU_SMS_MAX_PDU_DATA_LEN)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    LE_DEBUG("Sending message to self: len[%u] da[%s]", inLen, destNumber);
+
+    framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+    framePtr->protocol = submitPtr->protocol;
+    le_utf8_Copy((char *)framePtr->origAddress, localNumberPtr, sizeof(framePtr->origAddress),
+                 NULL);
+    le_utf8_Copy((char *)framePtr->destAddress, localNumberPtr, sizeof(framePtr->destAddress),
+                 NULL);
+
+    outPtr = framePtr->data;
+    memcpy(outPtr, inPtr, fields.smscLen);
+    outPtr += fields.smscLen;
+    *outPtr++ = SMS_GSM_MTI_DELIVER | SMS_GSM_MMS_NO_MORE |
+                (fields.firstOctet & (SMS_GSM_UDHI | SMS_GSM_RP));
+    memcpy(outPtr, &inPtr[fields.addressPos], fields.addressLen);
+    outPtr += fields.addressLen;
+    memcpy(outPtr, &inPtr[fields.pidPos], 2);
+    outPtr += 2;
+    EncodeGsmTimestamp(time(NULL), outPtr);
+    outPtr += SMS_GSM_SCTS_LEN;
+    memcpy(outPtr, &inPtr[fields.udPos], inLen - fields.udPos);
+    outPtr += inLen - fields.udPos;
+
+    framePtr->dataLen = outPtr - framePtr->data;
+    SmsCopyStats.rxCopiedBytes += framePtr->dataLen;
+
+    SmsServerHandleRemoteMessage(framePtr, NULL);
+    le_mem_Release(framePtr);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a phone number as a GSM address field (TP-OA or TP-DA).
+ *
+ * @return The length of the address field, or 0 if the number cannot be encoded.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t EncodeGsmAddress
+(
+    const char* numberPtr,      ///< [IN] Phone number
+    uint8_t* addressPtr         ///< [OUT] Address field, up to 2 + SMS_GSM_MAX_ADDRESS_DIGITS / 2
+)
+{
+    static const char digits[] = "0123456789*#abc";
+    uint32_t digitCnt;
+
+    addressPtr[1] = SMS_GSM_TOA_EXTENSION | SMS_GSM_NPI_ISDN;
+    if ('+' == *numberPtr)
+    {
+        addressPtr[1] |= SMS_GSM_TON_INTERNATIONAL;
+        numberPtr++;
+    }
+
+    for (digitCnt = 0; '\0' != numberPtr[digitCnt]; digitCnt++)
+    {
+        const char* digitPtr = strchr(digits, numberPtr[digitCnt]);
+        uint8_t* octetPtr = &addressPtr[2 + (digitCnt / 2)];
+
+        if ((NULL == digitPtr) || (digitCnt >= SMS_GSM_MAX_ADDRESS_DIGITS))
+        {
+            return 0;
+        }
+
+        if (digitCnt & 1)
+        {
+            *octetPtr = (*octetPtr & 0x0F) | ((digitPtr - digits) << 4);
+        }
+        else
+        {
+            // Filler in the high nibble, replaced by the next digit if any
+            *octetPtr = 0xF0 | (digitPtr - digits);
+        }
+    }
+
+    addressPtr[0] = digitCnt;
+    return 2 + ((digitCnt + 1) / 2);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the encoding of a GSM message from its data coding scheme (3GPP TS 23.038).
+ *
+ * @return LE_FORMAT_ERROR The alphabet is reserved.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetGsmDcsEncoding
+(
+    uint8_t dcs,                ///< [IN] TP-DCS
+    uint32_t* encodingPtr       ///< [OUT] PA_SIMU_SMS_CONCAT_7_BITS, _8_BITS or _UCS2
+)
+{
+    uint8_t alphabet;
+
+    if (0x00 == (dcs & 0x80))
+    {
+        // General data coding and automatic deletion groups
+        alphabet = (dcs >> 2) & 0x03;
+    }
+    else if (0xF0 == (dcs & 0xF0))
+    {
+        // Data coding/message class group
+        alphabet = (dcs >> 2) & 0x01;
+    }
+    else if (0xE0 == (dcs & 0xF0))
+    {
+        // Message waiting indication group, UCS2
+        alphabet = 2;
+    }
+    else
+    {
+        // Message waiting indication groups, default alphabet
+        alphabet = 0;
+    }
+
+    switch (alphabet)
+    {
+        case 0:
+            *encodingPtr = PA_SIMU_SMS_CONCAT_7_BITS;
+            return LE_OK;
+        case 1:
+            *encodingPtr = PA_SIMU_SMS_CONCAT_8_BITS;
+            return LE_OK;
+        case 2:
+            *encodingPtr = PA_SIMU_SMS_CONCAT_UCS2;
+            return LE_OK;
+        default:
+            return LE_FORMAT_ERROR;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pack septets in the user data of a GSM message, after the septets taken by the user data header.
+ * The octets written to must have been cleared.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PackGsmSeptets
+(
+    const uint8_t* septetsPtr,  ///< [IN] Septets, one per octet
+    uint32_t septetCnt,         ///< [IN] Number of septets
+    uint32_t firstSeptet,       ///< [IN] Position of the first septet in the user data
+    uint8_t* udPtr              ///< [OUT] User data
+)
+{
+    uint32_t i;
+
+    for (i = 0; i < septetCnt; i++)
+    {
+        uint32_t bitPos = (firstSeptet + i) * 7;
+        uint32_t shift = bitPos % 8;
+        uint8_t septet = septetsPtr[i] & 0x7F;
+
+        udPtr[bitPos / 8] |= septet << shift;
+        if (shift > 1)
+        {
+            udPtr[(bitPos / 8) + 1] |= septet >> (8 - shift);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Unpack septets from the user data of a GSM message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UnpackGsmSeptets
+(
+    const uint8_t* udPtr,       ///< [IN] User data
+    uint32_t firstSeptet,       ///< [IN] Position of the first septet in the user data
+    uint32_t septetCnt,         ///< [IN] Number of septets
+    uint8_t* septetsPtr         ///< [OUT] Septets, one per octet
+)
+{
+    uint32_t i;
+
+    for (i = 0; i < septetCnt; i++)
+    {
+        uint32_t bitPos = (firstSeptet + i) * 7;
+        uint32_t shift = bitPos % 8;
+        uint32_t value = udPtr[bitPos / 8] >> shift;
+
+        if (shift > 1)
+        {
+            value |= udPtr[(bitPos / 8) + 1] << (8 - shift);
+        }
+        septetsPtr[i] = value & 0x7F;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build a GSM SMS-DELIVER segment of a concatenated message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BuildGsmConcatSegment
+(
+    pa_sms_SimuPdu_t* segmentPtr,   ///< [OUT] Frame of the segment, header already set
+    const uint8_t* addressPtr,      ///< [IN] TP-OA
+    uint32_t addressLen,            ///< [IN] Length of TP-OA
+    uint32_t encoding,              ///< [IN] PA_SIMU_SMS_CONCAT_7_BITS, _8_BITS or _UCS2
+    uint8_t reference,              ///< [IN] Reference of the message
+    uint32_t segmentCnt,            ///< [IN] Number of segments
+    uint32_t segmentIdx,            ///< [IN] Index of the segment, from 0
+    const uint8_t* dataPtr,         ///< [IN] User data of the segment
+    uint32_t dataLen                ///< [IN] Length of the user data, in septets or octets
+)
+{
+    static const uint8_t dcs[] = {
+        [PA_SIMU_SMS_CONCAT_7_BITS] = 0x00,
+        [PA_SIMU_SMS_CONCAT_8_BITS] = 0x04,
+        [PA_SIMU_SMS_CONCAT_UCS2]   = 0x08,
+    };
+    uint8_t* outPtr = segmentPtr->data;
+    uint8_t* udPtr;
+
+    *outPtr++ = 0;      // No SMSC information
+    *outPtr++ = SMS_GSM_MTI_DELIVER | SMS_GSM_MMS_NO_MORE | SMS_GSM_UDHI;
+    memcpy(outPtr, addressPtr, addressLen);
+    outPtr += addressLen;
+    *outPtr++ = 0;      // TP-PID
+    *outPtr++ = dcs[encoding];
+    EncodeGsmTimestamp(time(NULL), outPtr);
+    outPtr += SMS_GSM_SCTS_LEN;
+
+    udPtr = outPtr + 1;
+    udPtr[0] = SMS_GSM_CONCAT_UDH_LEN - 1;
+    udPtr[1] = SMS_GSM_IEI_CONCAT_8BIT;
+    udPtr[2] = 3;
+    udPtr[3] = reference;
+    udPtr[4] = segmentCnt;
+    udPtr[5] = segmentIdx + 1;
+
+    if (PA_SIMU_SMS_CONCAT_7_BITS == encoding)
+    {
+        // The septets start on a septet boundary after the user data header
+        uint32_t udhSeptets = ((SMS_GSM_CONCAT_UDH_LEN * 8) + 6) / 7;
+        uint32_t udOctets = (((udhSeptets + dataLen) * 7) + 7) / 8;
+
+        memset(&udPtr[SMS_GSM_CONCAT_UDH_LEN], 0, udOctets - SMS_GSM_CONCAT_UDH_LEN);
+        PackGsmSeptets(dataPtr, dataLen, udhSeptets, udPtr);
+        *outPtr = udhSeptets + dataLen;
+        outPtr = udPtr + udOctets;
+    }
+    else
+    {
+        memcpy(&udPtr[SMS_GSM_CONCAT_UDH_LEN], dataPtr, dataLen);
+        *outPtr = SMS_GSM_CONCAT_UDH_LEN + dataLen;
+        outPtr = udPtr + SMS_GSM_CONCAT_UDH_LEN + dataLen;
+    }
+
+    segmentPtr->dataLen = outPtr - segmentPtr->data;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Inject a concatenated message sent by a client: its payload is split in GSM SMS-DELIVER segments,
+ * delivered with the simulated delay, order and loss of the frame.
+ *
+ * @return LE_FORMAT_ERROR The frame is not valid.
+ * @return LE_OUT_OF_RANGE The payload needs too many segments, or a setting is out of range.
+ * @return LE_NOT_POSSIBLE The modem is offline.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerHandleConcat
+(
+    const pa_sms_SimuPdu_t* framePtr    ///< [IN] PA_SIMU_SMS_FRAME_CONCAT frame
+)
+{
+    const pa_sms_SimuConcatHeader_t* headerPtr = (const pa_sms_SimuConcatHeader_t*)framePtr->data;
+    const uint8_t* payloadPtr = framePtr->data + sizeof(pa_sms_SimuConcatHeader_t);
+    char origNumber[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
+    uint8_t address[2 + (SMS_GSM_MAX_ADDRESS_DIGITS / 2)];
+    uint8_t order[PA_SIMU_SMS_MAX_CONCAT_CNT];
+    uint32_t payloadLen, segmentLen, segmentCnt, addressLen, delayMs, i;
+    uint8_t reference;
+
+    if (framePtr->dataLen < sizeof(pa_sms_SimuConcatHeader_t))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    payloadLen = framePtr->dataLen - sizeof(pa_sms_SimuConcatHeader_t);
+
+    switch (headerPtr->encoding)
+    {
+        case PA_SIMU_SMS_CONCAT_7_BITS:
+            segmentLen = SMS_GSM_MAX_SEPTETS - (((SMS_GSM_CONCAT_UDH_LEN * 8) + 6) / 7);
+            for (i = 0; i < payloadLen; i++)
+            {
+                if (payloadPtr[i] & 0x80)
+                {
+                    return LE_FORMAT_ERROR;
+                }
+            }
+            break;
+
+        case PA_SIMU_SMS_CONCAT_UCS2:
+            // Characters are never split between two segments
+            if (payloadLen & 1)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            // Fall through
+        case PA_SIMU_SMS_CONCAT_8_BITS:
+            segmentLen = SMS_GSM_MAX_UD_LEN - SMS_GSM_CONCAT_UDH_LEN;
+            break;
+
+        default:
+            return LE_FORMAT_ERROR;
+    }
+
+    segmentCnt = (0 == payloadLen) ? 1 : ((payloadLen + segmentLen - 1) / segmentLen);
+    if ((segmentCnt > PA_SIMU_SMS_MAX_CONCAT_CNT) || (headerPtr->lossPercent > 100) ||
+        (headerPtr->segmentDelayMs > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    le_utf8_Copy(origNumber, (const char*)framePtr->origAddress, sizeof(origNumber), NULL);
+    addressLen = EncodeGsmAddress(origNumber, address);
+    if (0 == addressLen)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (!mrc_simu_IsOnline())
+    {
+        LE_WARN("Not handling message because we're offline.");
+        return LE_NOT_POSSIBLE;
+    }
+
+    if (0 != headerPtr->reference)
+    {
+        reference = headerPtr->reference;
+    }
+    else
+    {
+        reference = SmsConcatNextReference++;
+        if (0 == SmsConcatNextReference)
+        {
+            SmsConcatNextReference = 1;
+        }
+    }
+
+    for (i = 0; i < segmentCnt; i++)
+    {
+        order[i] = i;
+    }
+
+    if (headerPtr->flags & PA_SIMU_SMS_CONCAT_REORDER)
+    {
+        for (i = segmentCnt - 1; i > 0; i--)
+        {
+            uint32_t j = rand() % (i + 1);
+            uint8_t idx = order[i];
+
+            order[i] = order[j];
+            order[j] = idx;
+        }
+    }
+
+    LE_DEBUG("Injecting concatenated message %u from '%s' in %u segments",
+             reference, origNumber, segmentCnt);
+    SmsConcatStats.injectedMsgCnt++;
+
+    // Each segment takes a delay slot, even if it is dropped
+    for (i = 0, delayMs = 0; i < segmentCnt; i++, delayMs += headerPtr->segmentDelayMs)
+    {
+        uint32_t idx = order[i];
+        uint32_t offset = idx * segmentLen;
+        uint32_t len = payloadLen - offset;
+        pa_sms_SimuPdu_t* segmentPtr;
+
+        if (((idx < 32) && (headerPtr->dropMask & (1U << idx))) ||
+            ((0 != headerPtr->lossPercent) && ((uint32_t)(rand() % 100) < headerPtr->lossPercent)))
+        {
+            LE_DEBUG("Segment %u/%u of message %u dropped", idx + 1, segmentCnt, reference);
+            SmsConcatStats.droppedSegmentCnt++;
+            continue;
+        }
+
+        segmentPtr = le_mem_ForceAlloc(SmsPduFramePool);
+        memcpy(segmentPtr, framePtr, sizeof(pa_sms_SimuPdu_t));
+        segmentPtr->protocol = PA_SMS_PROTOCOL_GSM;
+        BuildGsmConcatSegment(segmentPtr, address, addressLen, headerPtr->encoding, reference,
+                              segmentCnt, idx, &payloadPtr[offset],
+                              (len < segmentLen) ? len : segmentLen);
+
+        SmsScheduleDelivery(segmentPtr, delayMs, SMS_DELIVERY_SEGMENT);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give up the reassembly of a concatenated message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeleteConcatReassembly
+(
+    SmsConcatReassembly_t* reassemblyPtr    ///< [IN] Message being reassembled
+)
+{
+    le_dls_Remove(&SmsConcatReassemblies, &reassemblyPtr->link);
+    SmsConcatReassemblyCnt--;
+    le_mem_Release(reassemblyPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give up the concatenated messages whose first segment is older than the reassembly timeout.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ExpireConcatReassemblies
+(
+    le_clk_Time_t now       ///< [IN] Current relative time
+)
+{
+    le_clk_Time_t timeout = { .sec = SmsConcatTimeoutMs / 1000,
+                              .usec = (SmsConcatTimeoutMs % 1000) * 1000 };
+    le_dls_Link_t* linkPtr;
+
+    while (NULL != (linkPtr = le_dls_Peek(&SmsConcatReassemblies)))
+    {
+        SmsConcatReassembly_t* reassemblyPtr = CONTAINER_OF(linkPtr, SmsConcatReassembly_t, link);
+
+        if (le_clk_GreaterThan(le_clk_Add(reassemblyPtr->firstTime, timeout), now))
+        {
+            return;
+        }
+
+        LE_WARN("Concatenated message %u to '%s' expired, %d of %u segments received",
+                reassemblyPtr->reference, reassemblyPtr->destAddress,
+                __builtin_popcountll(reassemblyPtr->receivedMask), reassemblyPtr->segmentCnt);
+        SmsConcatStats.expiredMsgCnt++;
+        DeleteConcatReassembly(reassemblyPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Arm the reassembly timer for the oldest concatenated message, or stop it if there is none.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ArmConcatTimer
+(
+    le_clk_Time_t now       ///< [IN] Current relative time
+)
+{
+    le_clk_Time_t timeout = { .sec = SmsConcatTimeoutMs / 1000,
+                              .usec = (SmsConcatTimeoutMs % 1000) * 1000 };
+    le_dls_Link_t* linkPtr = le_dls_Peek(&SmsConcatReassemblies);
+    le_clk_Time_t delay = { 0, 0 };
+    le_clk_Time_t deadline;
+
+    le_timer_Stop(SmsConcatTimer);
+    if (NULL == linkPtr)
+    {
+        return;
+    }
+
+    deadline = le_clk_Add(CONTAINER_OF(linkPtr, SmsConcatReassembly_t, link)->firstTime, timeout);
+    if (le_clk_GreaterThan(deadline, now))
+    {
+        delay = le_clk_Sub(deadline, now);
+    }
+
+    // Round up, so that the timer never expires before the deadline
+    le_timer_SetMsInterval(SmsConcatTimer, (delay.sec * 1000) + (delay.usec / 1000) + 1);
+    le_timer_Start(SmsConcatTimer);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give up the concatenated messages which have expired, then rearm the reassembly timer for the
+ * next one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsConcatTimerHandler
+(
+    le_timer_Ref_t timerRef     ///< [IN] Reassembly timer
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    ExpireConcatReassemblies(now);
+    ArmConcatTimer(now);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the message being reassembled a segment belongs to, creating it if needed.
+ *
+ * @return The message being reassembled.
+ */
+//--------------------------------------------------------------------------------------------------
+static SmsConcatReassembly_t* GetConcatReassembly
+(
+    const char* destAddressPtr, ///< [IN] Destination of the message
+    uint32_t reference,         ///< [IN] Reference of the message
+    uint32_t segmentCnt,        ///< [IN] Number of segments
+    uint32_t encoding,          ///< [IN] Encoding of the segment
+    le_clk_Time_t now           ///< [IN] Current relative time
+)
+{
+    SmsConcatReassembly_t* reassemblyPtr;
+    le_dls_Link_t* linkPtr;
+
+    for (linkPtr = le_dls_Peek(&SmsConcatReassemblies);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(&SmsConcatReassemblies, linkPtr))
+    {
+        reassemblyPtr = CONTAINER_OF(linkPtr, SmsConcatReassembly_t, link);
+        if ((reassemblyPtr->reference == reference) &&
+            (reassemblyPtr->segmentCnt == segmentCnt) &&
+            (0 == strcmp(reassemblyPtr->destAddress, destAddressPtr)))
+        {
+            return reassemblyPtr;
+        }
+    }
+
+    // Make room by giving up the oldest message
+    if (SmsConcatReassemblyCnt >= PA_SIMU_SMS_MAX_CONCAT_PENDING)
+    {
+        reassemblyPtr = CONTAINER_OF(le_dls_Peek(&SmsConcatReassemblies),
+                                     SmsConcatReassembly_t, link);
+        LE_WARN("Too many concatenated messages, message %u to '%s' given up",
+                reassemblyPtr->reference, reassemblyPtr->destAddress);
+        SmsConcatStats.expiredMsgCnt++;
+        DeleteConcatReassembly(reassemblyPtr);
+    }
+
+    reassemblyPtr = le_mem_ForceAlloc(SmsConcatReassemblyPool);
+    reassemblyPtr->link = LE_DLS_LINK_INIT;
+    le_utf8_Copy(reassemblyPtr->destAddress, destAddressPtr, sizeof(reassemblyPtr->destAddress),
+                 NULL);
+    reassemblyPtr->reference = reference;
+    reassemblyPtr->encoding = encoding;
+    reassemblyPtr->segmentCnt = segmentCnt;
+    reassemblyPtr->receivedMask = 0;
+    reassemblyPtr->firstTime = now;
+    le_dls_Queue(&SmsConcatReassemblies, &reassemblyPtr->link);
+    SmsConcatReassemblyCnt++;
+
+    if (!le_timer_IsRunning(SmsConcatTimer))
+    {
+        ArmConcatTimer(now);
+    }
+
+    return reassemblyPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a reassembled concatenated message to the clients asking for it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerSendConcat
+(
+    const SmsConcatReassembly_t* reassemblyPtr, ///< [IN] Reassembled message
+    uint32_t reassemblyUs                       ///< [IN] Reassembly time
+)
+{
+    pa_sms_SimuPdu_t* framePtr = le_mem_ForceAlloc(SmsBatchFramePool);
+    pa_sms_SimuConcatHeader_t* headerPtr = (pa_sms_SimuConcatHeader_t*)framePtr->data;
+    const char* localNumber = GetLocalNumber();
+    uint8_t* outPtr = framePtr->data + sizeof(pa_sms_SimuConcatHeader_t);
+    le_dls_Link_t* linkPtr;
+    uint32_t i;
+
+    memset(framePtr, 0, sizeof(pa_sms_SimuPdu_t) + sizeof(pa_sms_SimuConcatHeader_t));
+    framePtr->protocol = PA_SIMU_SMS_FRAME_CONCAT;
+    if (NULL != localNumber)
+    {
+        le_utf8_Copy((char *)framePtr->origAddress, localNumber, sizeof(framePtr->origAddress),
+                     NULL);
+    }
+    le_utf8_Copy((char *)framePtr->destAddress, reassemblyPtr->destAddress,
+                 sizeof(framePtr->destAddress), NULL);
+
+    headerPtr->encoding = reassemblyPtr->encoding;
+    headerPtr->reference = reassemblyPtr->reference;
+    headerPtr->segmentCnt = reassemblyPtr->segmentCnt;
+    headerPtr->reassemblyUs = reassemblyUs;
+
+    for (i = 0; i < reassemblyPtr->segmentCnt; i++)
+    {
+        memcpy(outPtr, reassemblyPtr->segmentData[i], reassemblyPtr->segmentLen[i]);
+        outPtr += reassemblyPtr->segmentLen[i];
+    }
+    framePtr->dataLen = outPtr - framePtr->data;
+
+    for (linkPtr = le_dls_Peek(&SmsServerConnections);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(&SmsServerConnections, linkPtr))
+    {
+        SmsServerConnection_t* connPtr = CONTAINER_OF(linkPtr, SmsServerConnection_t, link);
+
+        if (connPtr->concatReassembly)
+        {
+            SmsServerSendFrame(connPtr, framePtr);
+        }
+    }
+
+    le_mem_Release(framePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reassemble the GSM SMS-SUBMIT segments of the concatenated messages sent by the Legato world.
+ *
+ * Once all the segments of a message have been sent, it is sent to the clients asking for it as a
+ * PA_SIMU_SMS_FRAME_CONCAT frame.
+ *
+ * @return LE_NOT_FOUND    The PDU is not a segment of a concatenated message.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerReassembleGsm
+(
+    const pa_sms_SimuPdu_t* submitPtr   ///< [IN] SMS-SUBMIT, with SMSC information
+)
+{
+    const uint8_t* inPtr = submitPtr->data;
+    char destNumber[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
+    SmsConcatReassembly_t* reassemblyPtr;
+    SmsGsmSubmit_t fields;
+    const uint8_t* udPtr;
+    uint32_t encoding, udl, udOctets, udhLen, pos, dataLen;
+    uint32_t reference = 0, segmentCnt = 0, segmentNum = 0;
+    uint64_t allMask;
+    le_clk_Time_t now;
+
+    if ((PA_SMS_PROTOCOL_GSM != submitPtr->protocol) ||
+        (LE_OK != ParseGsmSubmit(submitPtr, &fields)) ||
+        (0 == (fields.firstOctet & SMS_GSM_UDHI)) ||
+        (LE_OK != GetGsmDcsEncoding(inPtr[fields.pidPos + 1], &encoding)) ||
+        (LE_OK != DecodeGsmAddress(&inPtr[fields.addressPos], destNumber, sizeof(destNumber))))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    udl = inPtr[fields.udPos];
+    udPtr = &inPtr[fields.udPos + 1];
+    udOctets = (PA_SIMU_SMS_CONCAT_7_BITS == encoding) ? (((udl * 7) + 7) / 8) : udl;
+    if ((0 == udOctets) || (udOctets > (submitPtr->dataLen - fields.udPos - 1)) ||
+        ((1U + udPtr[0]) > udOctets))
+    {
+        return LE_NOT_FOUND;
+    }
+    udhLen = 1 + udPtr[0];
+
+    // Look for the concatenation information element
+    for (pos = 1; ((pos + 2) <= udhLen) && ((pos + 2 + udPtr[pos + 1]) <= udhLen);
+         pos += 2 + udPtr[pos + 1])
+    {
+        const uint8_t* iePtr = &udPtr[pos];
+
+        if ((SMS_GSM_IEI_CONCAT_8BIT == iePtr[0]) && (3 == iePtr[1]))
+        {
+            reference = iePtr[2];
+            segmentCnt = iePtr[3];
+            segmentNum = iePtr[4];
+        }
+        else if ((SMS_GSM_IEI_CONCAT_16BIT == iePtr[0]) && (4 == iePtr[1]))
+        {
+            reference = (iePtr[2] << 8) | iePtr[3];
+            segmentCnt = iePtr[4];
+            segmentNum = iePtr[5];
+        }
+    }
+
+    if ((0 == segmentNum) || (segmentNum > segmentCnt) ||
+        (segmentCnt > PA_SIMU_SMS_MAX_CONCAT_CNT))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    if (PA_SIMU_SMS_CONCAT_7_BITS == encoding)
+    {
+        uint32_t udhSeptets = ((udhLen * 8) + 6) / 7;
+
+        if ((udl < udhSeptets) || ((udl - udhSeptets) > PA_SIMU_SMS_MAX_CONCAT_SEGMENT_LEN))
+        {
+            return LE_NOT_FOUND;
+        }
+        dataLen = udl - udhSeptets;
+    }
+    else
+    {
+        dataLen = udl - udhLen;
+        if (dataLen > PA_SIMU_SMS_MAX_CONCAT_SEGMENT_LEN)
+        {
+            return LE_NOT_FOUND;
+        }
+    }
+
+    now = le_clk_GetRelativeTime();
+    ExpireConcatReassemblies(now);
+    SmsConcatStats.segmentCnt++;
+
+    reassemblyPtr = GetConcatReassembly(destNumber, reference, segmentCnt, encoding, now);
+    if (PA_SIMU_SMS_CONCAT_7_BITS == encoding)
+    {
+        UnpackGsmSeptets(udPtr, udl - dataLen, dataLen,
+                         reassemblyPtr->segmentData[segmentNum - 1]);
+    }
+    else
+    {
+        memcpy(reassemblyPtr->segmentData[segmentNum - 1], &udPtr[udhLen], dataLen);
+    }
+    reassemblyPtr->segmentLen[segmentNum - 1] = dataLen;
+    reassemblyPtr->receivedMask |= 1ULL << (segmentNum - 1);
+
+    allMask = (segmentCnt < 64) ? ((1ULL << segmentCnt) - 1) : UINT64_MAX;
+    if (allMask == reassemblyPtr->receivedMask)
+    {
+        le_clk_Time_t elapsed = le_clk_Sub(now, reassemblyPtr->firstTime);
+        uint64_t elapsedUs = ((uint64_t)elapsed.sec * 1000000) + elapsed.usec;
+
+        LE_DEBUG("Concatenated message %u to '%s' reassembled from %u segments in %" PRIu64 " us",
+                 reference, destNumber, segmentCnt, elapsedUs);
+        SmsConcatStats.reassembledMsgCnt++;
+        SmsConcatStats.reassemblyTotalUs += elapsedUs;
+        if (elapsedUs > SmsConcatStats.reassemblyMaxUs)
+        {
+            SmsConcatStats.reassemblyMaxUs = elapsedUs;
+        }
+
+        SmsServerSendConcat(reassemblyPtr, (elapsedUs > UINT32_MAX) ? UINT32_MAX : elapsedUs);
+        DeleteConcatReassembly(reassemblyPtr);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Draw the TP-ST of a status report from the configured outcomes.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t DrawStatusReportOutcome
+(
+    void
+)
+{
+    uint32_t draw = rand() % SmsStatusReportTotalWeight;
+    uint32_t i;
+
+    for (i = 0; i < (SmsStatusReportOutcomeCnt - 1); i++)
+    {
+        if (draw < SmsStatusReportOutcomes[i].weight)
+        {
+            break;
+        }
+        draw -= SmsStatusReportOutcomes[i].weight;
+    }
+
+    return SmsStatusReportOutcomes[i].status;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedule the GSM SMS-STATUS-REPORT of a submitted message, if its SMS-SUBMIT requests one.
+ *
+ * The report refers to the message through the TP-MR returned to the caller of
+ * pa_sms_SendPduMsg(), and to its destination through TP-RA. It is delivered the status report
+ * delay after the message itself, and its TP-DT is the delivery time of the message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerScheduleStatusReport
+(
+    const pa_sms_SimuPdu_t* submitPtr,  ///< [IN] SMS-SUBMIT, with SMSC information
+    uint8_t msgRef,                     ///< [IN] TP-MR of the message
+    uint32_t deliveryDelayMs            ///< [IN] Delay before the delivery of the message
+)
+{
+    pa_sms_SimuPdu_t* framePtr;
+    SmsGsmSubmit_t fields;
+    uint32_t delayMs = deliveryDelayMs + SmsStatusReportDelayMs;
+    const char* localNumber;
+    time_t now;
+    uint8_t* outPtr;
+
+    if ((PA_SMS_PROTOCOL_GSM != submitPtr->protocol) ||
+        (LE_OK != ParseGsmSubmit(submitPtr, &fields)) ||
+        (0 == (fields.firstOctet & SMS_GSM_SRR)) ||
+        (fields.addressLen > (2 + (SMS_GSM_MAX_ADDRESS_DIGITS / 2))))
+    {
+        return;
+    }
+
+    if (SmsStatusReportJitterMs > 0)
+    {
+        delayMs += rand() % (SmsStatusReportJitterMs + 1);
+    }
+
+    framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+    memset(framePtr, 0, sizeof(pa_sms_SimuPdu_t));
+    framePtr->protocol = PA_SMS_PROTOCOL_GSM;
+    if (LE_OK != DecodeGsmAddress(&submitPtr->data[fields.addressPos],
+                                  (char *)framePtr->origAddress, sizeof(framePtr->origAddress)))
+    {
+        framePtr->origAddress[0] = '\0';
+    }
+    localNumber = GetLocalNumber();
+    if (NULL != localNumber)
+    {
+        le_utf8_Copy((char *)framePtr->destAddress, localNumber, sizeof(framePtr->destAddress),
+                     NULL);
+    }
+
+    now = time(NULL);
+    outPtr = framePtr->data;
+    *outPtr++ = 0;      // No SMSC information
+    *outPtr++ = SMS_GSM_MTI_STATUS_REPORT | SMS_GSM_MMS_NO_MORE;
+    *outPtr++ = msgRef;
+    memcpy(outPtr, &submitPtr->data[fields.addressPos], fields.addressLen);
+    outPtr += fields.addressLen;
+    EncodeGsmTimestamp(now, outPtr);
+    outPtr += SMS_GSM_SCTS_LEN;
+    EncodeGsmTimestamp(now + (deliveryDelayMs / 1000), outPtr);
+    outPtr += SMS_GSM_SCTS_LEN;
+    *outPtr++ = DrawStatusReportOutcome();
+    framePtr->dataLen = outPtr - framePtr->data;
+
+    LE_DEBUG("Status report of TP-MR %u with TP-ST 0x%02x in %u ms",
+             msgRef, framePtr->data[framePtr->dataLen - 1], delayMs);
+    SmsTxStats.statusReportCnt++;
+    SmsScheduleDelivery(framePtr, delayMs, SMS_DELIVERY_STATUS_REPORT);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function handle messages originating from the Legato world.
+ *
+ * @return LE_FAULT        There was an error when handling the message.
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SmsServerHandleLocalMessage
+(
+    pa_sms_SimuPdu_t * sourceMsgPtr
+)
+{
+    le_dls_Link_t* linkPtr;
+    bool isSegment = (LE_OK == SmsServerReassembleGsm(sourceMsgPtr));
+
+    /* Deliver message to each connection */
+    for (linkPtr = le_dls_Peek(&SmsServerConnections);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(&SmsServerConnections, linkPtr))
+    {
+        SmsServerConnection_t* connPtr = CONTAINER_OF(linkPtr, SmsServerConnection_t, link);
+
+        // These clients get the whole message once all its segments are sent
+        if (isSegment && connPtr->concatReassembly)
+        {
+            continue;
+        }
+        SmsServerSendFrame(connPtr, sourceMsgPtr);
+    }
+
+    /* Deliver message locally if necessary */
+    {
+        pa_sms_Message_t decodedMessage;
+        le_result_t res;
+        const char* localNumber = GetLocalNumber();
+
+        if (NULL == localNumber)
+        {
+            LE_ERROR("Unable to get subscriber phone number.");
+            return LE_FAULT;
+        }
+
+        if (PA_SMS_PROTOCOL_GSM == sourceMsgPtr->protocol)
+        {
+            res = SmsServerLoopbackGsm(sourceMsgPtr, localNumber);
+            if (LE_NOT_FOUND == res)
+            {
+                LE_DEBUG("Message not sent to self (='%s')", localNumber);
+                return LE_OK;
+            }
+            else if (LE_FORMAT_ERROR != res)
+            {
+                return res;
+            }
+            // Let the full decoding below report the error
+        }
+
+        res = smsPdu_Decode(sourceMsgPtr->protocol,
+                            sourceMsgPtr->data,
+                            sourceMsgPtr->dataLen,
+                            true,
+                            &decodedMessage);
+        if(res != LE_OK)
+        {
+            LE_ERROR("Unable to decode message.");
+            return LE_FAULT;
+        }
+
+        if(decodedMessage.type != PA_SMS_SUBMIT)
+        {
+            LE_ERROR("Unexpected type of PDU message.");
+            return LE_FAULT;
+        }
+
+        /* Destination and local number are the same */
+        if (0 == strncmp(decodedMessage.smsSubmit.da, localNumber, LE_MDMDEFS_PHONE_NUM_MAX_LEN))
+        {
+            pa_sms_Pdu_t pdu;
+            le_result_t res;
+            smsPdu_Encoding_t encoding;
+            smsPdu_DataToEncode_t data;
+            pa_sms_SimuPdu_t* framePtr;
+
+            switch (decodedMessage.smsSubmit.format)
+            {
+                case LE_SMS_FORMAT_BINARY:
+                case LE_SMS_FORMAT_PDU:
+                    encoding = SMSPDU_8_BITS;
+                    break;
+
+                case LE_SMS_FORMAT_TEXT:
+                    encoding = SMSPDU_7_BITS;
+                    break;
+
+                default:
+                    LE_ERROR("Unexpected format");
+                    return LE_FAULT;
+            }
+
+            LE_DEBUG("Sending message to self: len[%u] da[%s] format[%d] encoding[%d] protocol[%u]",
+                    decodedMessage.smsSubmit.dataLen,
+                    decodedMessage.smsSubmit.da,
+                    decodedMessage.smsSubmit.format,
+                    encoding,
+                    sourceMsgPtr->protocol);
+
+            memset(&data, 0, sizeof(data));
+            data.protocol = sourceMsgPtr->protocol;
+            data.messagePtr = decodedMessage.smsSubmit.data;
+            data.length = decodedMessage.smsSubmit.dataLen;
+            data.addressPtr = decodedMessage.smsSubmit.da;
+            data.encoding = encoding;
+            data.messageType = PA_SMS_DELIVER;
+            data.statusReport = false;
+
+            res = smsPdu_Encode(&data, &pdu);
+            if(res != LE_OK)
+            {
+                LE_ERROR("Unable to encode message.");
+                return LE_FAULT;
+            }
+
+            framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+            framePtr->protocol = sourceMsgPtr->protocol;
+            strncpy((char *)framePtr->origAddress, localNumber, sizeof(framePtr->origAddress));
+            strncpy((char *)framePtr->destAddress, localNumber, sizeof(framePtr->destAddress));
+
+            framePtr->dataLen = pdu.dataLen;
+            memcpy(framePtr->data, pdu.data, pdu.dataLen);
+            SmsCopyStats.rxCopiedBytes += pdu.dataLen;
+
+            SmsServerHandleRemoteMessage(framePtr, NULL);
+            le_mem_Release(framePtr);
+        }
+        else
+        {
+            LE_DEBUG("Message not sent to self (='%s')", localNumber);
+        }
+    }
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver the messages whose simulated delay has expired, then rearm the delivery timer for the
+ * next one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsDeliveryTimerHandler
+(
+    le_timer_Ref_t timerRef     ///< [IN] Delivery timer
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+    le_dls_Link_t* linkPtr;
+
+    while (NULL != (linkPtr = le_dls_Peek(&SmsPendingDeliveries)))
+    {
+        SmsPendingDelivery_t* pendingPtr = CONTAINER_OF(linkPtr, SmsPendingDelivery_t, link);
+
+        if (le_clk_GreaterThan(pendingPtr->deadline, now))
+        {
+            le_clk_Time_t delay = le_clk_Sub(pendingPtr->deadline, now);
+
+            // Round up, so that the timer never expires before the deadline
+            le_timer_SetMsInterval(timerRef, (delay.sec * 1000) + (delay.usec / 1000) + 1);
+            le_timer_Start(timerRef);
+            return;
+        }
+
+        le_dls_Remove(&SmsPendingDeliveries, linkPtr);
+        switch (pendingPtr->type)
+        {
+            case SMS_DELIVERY_SUBMITTED:
+                SmsTxStats.deliveredCnt++;
+                SmsServerHandleLocalMessage(pendingPtr->framePtr);
+                break;
+
+            case SMS_DELIVERY_SEGMENT:
+                SmsConcatStats.injectedSegmentCnt++;
+                SmsServerHandleRemoteMessage(pendingPtr->framePtr, NULL);
+                break;
+
+            case SMS_DELIVERY_STATUS_REPORT:
+                SmsTxStats.statusReportDeliveredCnt++;
+                SmsServerHandleRemoteMessage(pendingPtr->framePtr, NULL);
+                break;
+        }
+        le_mem_Release(pendingPtr->framePtr);
+        le_mem_Release(pendingPtr);
+    }
+}
 
-static le_event_Id_t          EventNewSmsId;
-static le_event_HandlerRef_t  NewSMSHandlerRef;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Submit a message originating from the Legato world.
+ *
+ * The message is delivered to the clients and to self after the simulated delay, the reference of
+ * the caller on the frame buffer is taken over.
+ *
+ * @return Delay before the delivery, in ms.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SmsServerSubmitMessage
+(
+    pa_sms_SimuPdu_t * framePtr         ///< [IN] Message, allocated from a frame buffer pool
+)
+{
+    uint32_t delayMs = SmsDeliveryDelayMs;
 
-static int SmsServerListenFd;
-static le_fdMonitor_Ref_t SmsServerMonitorRef;
+    SmsTxStats.submittedCnt++;
 
-typedef struct {
-    bool used;
-    int fd;
-    le_fdMonitor_Ref_t fdMonitorRef;
+    if (SmsDeliveryJitterMs > 0)
+    {
+        delayMs += rand() % (SmsDeliveryJitterMs + 1);
+    }
+
+    // Messages without delay are delivered right away, unless earlier ones are still pending
+    if ((0 == delayMs) && le_dls_IsEmpty(&SmsPendingDeliveries))
+    {
+        SmsTxStats.deliveredCnt++;
+        SmsServerHandleLocalMessage(framePtr);
+        le_mem_Release(framePtr);
+        return 0;
+    }
+
+    SmsScheduleDelivery(framePtr, delayMs, SMS_DELIVERY_SUBMITTED);
+
+    return delayMs;
 }
-SmsServerConnection_t;
 
-static SmsServerConnection_t SmsServerConnections[PA_SMS_SIMU_MAX_CONN];
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedule the delivery of a message after a delay, taking over the reference of the caller on the
+ * frame buffer. Messages with the same deadline are delivered in the order they are scheduled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsScheduleDelivery
+(
+    pa_sms_SimuPdu_t * framePtr,        ///< [IN] Message, allocated from a frame buffer pool
+    uint32_t delayMs,                   ///< [IN] Delay before the delivery
+    SmsDeliveryType_t type              ///< [IN] How to deliver the message
+)
+{
+    SmsPendingDelivery_t* pendingPtr = le_mem_ForceAlloc(SmsPendingDeliveryPool);
+    le_dls_Link_t* linkPtr;
+
+    pendingPtr->link = LE_DLS_LINK_INIT;
+    pendingPtr->framePtr = framePtr;
+    pendingPtr->type = type;
+    pendingPtr->deadline = le_clk_Add(le_clk_GetRelativeTime(),
+                                      (le_clk_Time_t){ .sec = delayMs / 1000,
+                                                       .usec = (delayMs % 1000) * 1000 });
+
+    // Keep the list sorted by deadline, the jitter may reorder the messages
+    linkPtr = le_dls_PeekTail(&SmsPendingDeliveries);
+    while ((NULL != linkPtr) &&
+           le_clk_GreaterThan(CONTAINER_OF(linkPtr, SmsPendingDelivery_t, link)->deadline,
+                              pendingPtr->deadline))
+    {
+        linkPtr = le_dls_PeekPrev(&SmsPendingDeliveries, linkPtr);
+    }
 
-/** Memory **/
+    if (NULL == linkPtr)
+    {
+        le_dls_Stack(&SmsPendingDeliveries, &pendingPtr->link);
 
-typedef struct {
-    pa_sms_Pdu_t pduContent;
+        // New earliest deadline
+        le_timer_Stop(SmsDeliveryTimer);
+        SmsDeliveryTimerHandler(SmsDeliveryTimer);
+    }
+    else
+    {
+        le_dls_AddAfter(&SmsPendingDeliveries, linkPtr, &pendingPtr->link);
+    }
 }
-SmsMsgInMemory;
 
-typedef struct {
-    pa_sms_Storage_t storage;
-    uint32_t         index;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of simultaneous connections.
+ *
+ * The new limit only applies to the connections accepted afterwards.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetMaxConnections
+(
+    int32_t value           ///< [IN] Maximum number of connections
+)
+{
+    if ((value < 1) || (value > PA_SIMU_SMS_MAX_CONN_LIMIT))
+    {
+        LE_ERROR("Invalid maximum number of connections %d", value);
+        return;
+    }
+
+    SmsServerMaxConnections = value;
+    LE_INFO("SMS server accepts up to %u connections", SmsServerMaxConnections);
 }
-SmsMsgRef;
 
-#define PA_SMS_SIMU_STORAGE_CNT     PA_SMS_STORAGE_SIM
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of frames queued on one connection.
+ *
+ * Frames already queued are kept, only the new ones are dropped if the queue is over the limit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetTxQueueMax
+(
+    int32_t value           ///< [IN] Maximum number of frames
+)
+{
+    if ((value < 1) || (value > PA_SIMU_SMS_MAX_TX_QUEUE_MAX))
+    {
+        LE_ERROR("Invalid maximum number of queued frames %d", value);
+        return;
+    }
 
-static SmsMsgInMemory SmsMem[PA_SMS_SIMU_STORAGE_CNT][PA_SMS_SIMU_MAX_MSG_IN_MEM];
-static le_mem_PoolRef_t SmsMemPoolRef;
+    SmsServerTxQueueMax = value;
 
-static char SmsSmsc[LE_MDMDEFS_PHONE_NUM_MAX_LEN] = PA_SIMU_SMS_DEFAULT_SMSC;
+    LE_INFO("Up to %u frames queued per SMS server connection", SmsServerTxQueueMax);
+}
 
-static le_result_t SmsServerHandleLocalMessage
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the maximum number of entries of the cell broadcast configuration.
+ *
+ * The entries already configured are kept, only the new ones are refused over the limit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetCellBroadcastMax
 (
-    pa_sms_SimuPdu_t * sourceMsgPtr
-);
+    int32_t value           ///< [IN] Maximum number of entries
+)
+{
+    if ((value < 1) || (value > PA_SIMU_SMS_MAX_CB_CONFIG_MAX))
+    {
+        LE_ERROR("Invalid maximum number of cell broadcast entries %d", value);
+        return;
+    }
 
-static le_result_t SmsServerHandleRemoteMessage
+    CellBroadcastConfigMax = value;
+
+    LE_INFO("Up to %u cell broadcast ranges and services", CellBroadcastConfigMax);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the reassembly timeout of the concatenated messages.
+ *
+ * The new timeout also applies to the messages being reassembled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetConcatTimeout
 (
-    pa_sms_SimuPdu_t * sourceMsgPtr
-);
+    int32_t value           ///< [IN] Timeout in milliseconds
+)
+{
+    if ((value < 1) || (value > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
+    {
+        LE_ERROR("Invalid concatenated message timeout %d", value);
+        return;
+    }
 
-pa_sms_StorageMsgHdlrFunc_t StorageMsgHdlr=NULL;
-pa_sms_NewMsgHdlrFunc_t  NewSMSHandler=NULL;
+    SmsConcatTimeoutMs = value;
 
-static le_sms_Storage_t PrefSmsStorage;
+    LE_INFO("Concatenated messages given up after %u ms", SmsConcatTimeoutMs);
+    ArmConcatTimer(le_clk_GetRelativeTime());
+}
 
-static int NumberSmsInStorageNv=0;
-static int NumberSmsInStorageSim=0;
-static int NumberSmsInStorageNone=0;
-static int SmsSendErrorCause;
-static char SMSMessageReference=0;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the fixed part of the delivery delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetDeliveryDelay
+(
+    int32_t value           ///< [IN] Delay in milliseconds
+)
+{
+    if ((value < 0) || (value > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
+    {
+        LE_ERROR("Invalid delivery delay %d", value);
+        return;
+    }
 
-#define  PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX    50
-#define  PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX   50
+    SmsDeliveryDelayMs = value;
 
+    LE_INFO("SMS delivery delay set to %u ms", SmsDeliveryDelayMs);
+}
 
-typedef struct {
-    uint16_t fromId;
-    uint16_t toId;
-    bool selected;
-} BoardcastConfigInfo3gpp_t;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the random part of the delivery delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetDeliveryJitter
+(
+    int32_t value           ///< [IN] Maximum jitter in milliseconds
+)
+{
+    if ((value < 0) || (value > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
+    {
+        LE_ERROR("Invalid delivery jitter %d", value);
+        return;
+    }
 
-typedef struct {
+    SmsDeliveryJitterMs = value;
 
-    le_sms_CdmaServiceCat_t serviceCategory;
-    le_sms_Languages_t language;
-    bool selected;
-} BoardcastConfigInfo3gpp2_t;
+    LE_INFO("SMS delivery jitter set to %u ms", SmsDeliveryJitterMs);
+}
 
-typedef struct
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the fixed part of the status report delay.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatusReportDelay
+(
+    int32_t value           ///< [IN] Delay in milliseconds
+)
 {
-    uint32_t nbCell3GPPConfig;
-    uint32_t nbCell3GPP2Config;
-    BoardcastConfigInfo3gpp_t Cell3GPPBroadcast[PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX];
-    BoardcastConfigInfo3gpp2_t Cell3GPP2Broadcast[PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX];
-} CellBroadCast_t;
+    if ((value < 0) || (value > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
+    {
+        LE_ERROR("Invalid status report delay %d", value);
+        return;
+    }
 
-static CellBroadCast_t CellBroadcastConfig;
+    SmsStatusReportDelayMs = value;
+
+    LE_INFO("SMS status report delay set to %u ms", SmsStatusReportDelayMs);
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Get message data in memory.
+ * Set the random part of the status report delay.
  */
 //--------------------------------------------------------------------------------------------------
-static SmsMsgInMemory * GetSmsMsg
+static void SetStatusReportJitter
 (
-    pa_sms_Storage_t    storage,    ///< [IN] SMS Storage used
-    uint32_t            index       ///< [IN] The place of storage in memory.
+    int32_t value           ///< [IN] Maximum jitter in milliseconds
 )
 {
-    if ( (storage == PA_SMS_STORAGE_UNKNOWN) || (storage > PA_SMS_SIMU_STORAGE_CNT) )
+    if ((value < 0) || (value > PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS))
     {
-        return NULL;
+        LE_ERROR("Invalid status report jitter %d", value);
+        return;
+    }
+
+    SmsStatusReportJitterMs = value;
+
+    LE_INFO("SMS status report jitter set to %u ms", SmsStatusReportJitterMs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the outcomes of the status reports from a string.
+ *
+ * The string is a comma-separated list of 'status:weight' entries, where status is a TP-ST value
+ * (e.g. 0x00 for a delivered message, 0x41 for an incompatible destination) and weight its relative
+ * probability. The weight can be omitted, it is then 1. The outcomes are kept unchanged if the
+ * string is not valid.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatusReportOutcomesFromString
+(
+    const char* valueStr    ///< [IN] Comma-separated 'status:weight' list
+)
+{
+    SmsStatusReportOutcome_t outcomes[PA_SIMU_SMS_MAX_SR_OUTCOMES];
+    uint32_t outcomeCnt = 0;
+    uint64_t totalWeight = 0;
+    const char* strPtr = valueStr;
+
+    while ('\0' != *strPtr)
+    {
+        char* endPtr;
+        unsigned long status = strtoul(strPtr, &endPtr, 0);
+        unsigned long weight = 1;
+
+        if ((endPtr == strPtr) || (status > UINT8_MAX) ||
+            (outcomeCnt >= PA_SIMU_SMS_MAX_SR_OUTCOMES))
+        {
+            LE_ERROR("Invalid status report outcomes '%s'", valueStr);
+            return;
+        }
+
+        if (':' == *endPtr)
+        {
+            strPtr = endPtr + 1;
+            weight = strtoul(strPtr, &endPtr, 10);
+            if ((endPtr == strPtr) || (weight > UINT16_MAX))
+            {
+                LE_ERROR("Invalid status report outcomes '%s'", valueStr);
+                return;
+            }
+        }
+
+        if ((',' != *endPtr) && ('\0' != *endPtr))
+        {
+            LE_ERROR("Invalid status report outcomes '%s'", valueStr);
+            return;
+        }
+
+        outcomes[outcomeCnt].status = status;
+        outcomes[outcomeCnt].weight = weight;
+        outcomeCnt++;
+        totalWeight += weight;
+        strPtr = (',' == *endPtr) ? (endPtr + 1) : endPtr;
     }
 
-    if ( (index >= PA_SMS_SIMU_MAX_MSG_IN_MEM) )
+    if (0 == totalWeight)
     {
-        return NULL;
+        LE_ERROR("Invalid status report outcomes '%s'", valueStr);
+        return;
     }
 
-    return &SmsMem[storage-1][index];
+    memcpy(SmsStatusReportOutcomes, outcomes, outcomeCnt * sizeof(SmsStatusReportOutcome_t));
+    SmsStatusReportOutcomeCnt = outcomeCnt;
+    SmsStatusReportTotalWeight = totalWeight;
+    LE_INFO("%u status report outcomes set", outcomeCnt);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Get the message bank where incoming message should be stored.
+ * Close a connection to the SMS server and release its state.
  */
 //--------------------------------------------------------------------------------------------------
-static pa_sms_Storage_t GetCurrentIncomingStorage
+static void SmsServerCloseConnection
 (
-    void
+    SmsServerConnection_t* connPtr  ///< [IN] Connection to close
 )
 {
-    le_result_t res;
-    le_mrc_Rat_t rat;
+    int result;
 
-    res = pa_mrc_GetRadioAccessTechInUse(&rat);
-    if (LE_OK != res)
+    LE_DEBUG("Releasing connection[%u] fd=%d (rx=%u tx=%u dropped=%u)",
+             connPtr->id, connPtr->fd, connPtr->rxMsgCnt, connPtr->txMsgCnt, connPtr->txDropCnt);
+    LE_WARN_IF(connPtr->txDropCnt > 0, "%u messages dropped for slow conn[%u]",
+               connPtr->txDropCnt, connPtr->id);
+
+    le_fdMonitor_Delete(connPtr->fdMonitorRef);
+
+    // Close the connection.
+    do
     {
-        return PA_SMS_STORAGE_SIM;
+        result = close(connPtr->fd);
+    } while ((result == -1) && (errno == EINTR));
+    LE_CRIT_IF(result == -1, "close() failed for connection fd %d. Errno %m.", connPtr->fd);
+
+    // Pending delivery reports may still reference the connection
+    connPtr->fd = -1;
+    connPtr->fdMonitorRef = NULL;
+
+    if (NULL != connPtr->rxFramePtr)
+    {
+        le_mem_Release(connPtr->rxFramePtr);
     }
 
-    if (LE_MRC_RAT_CDMA == rat)
+    while (connPtr->txQueueCnt > 0)
     {
-        return PA_SMS_STORAGE_NV;
+        SmsServerPopTxFrame(connPtr);
+        SmsTxStats.failedCnt++;
     }
 
-    return PA_SMS_STORAGE_SIM;
+    le_dls_Remove(&SmsServerConnections, &(connPtr->link));
+    SmsServerConnectionCnt--;
+
+    le_mem_Release(connPtr);
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a delivery report, once the new message handler has been called for the messages it covers.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerSendDeliveryReport
+(
+    void* param1Ptr,    ///< [IN] Connection, referenced
+    void* param2Ptr     ///< [IN] PA_SIMU_SMS_FRAME_DELIVERED frame
+)
+{
+    SmsServerConnection_t* connPtr = param1Ptr;
+    pa_sms_SimuPdu_t* framePtr = param2Ptr;
+
+    // The connection may have been closed in the meantime
+    if (connPtr->fd >= 0)
+    {
+        SmsServerSendFrame(connPtr, framePtr);
+    }
+
+    le_mem_Release(framePtr);
+    le_mem_Release(connPtr);
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function is called to set the preferred SMS storage area.
+ * Queue a delivery report for the PDUs of a frame, if the connection asked for them.
  *
- * @return LE_FAULT         The function failed.
- * @return LE_OK            The function succeeded.
+ * The report is queued after the new message events of these PDUs, so it is sent once the new
+ * message handler has been called for them.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_SetPreferredStorage
+static void SmsServerQueueDeliveryReport
 (
-    le_sms_Storage_t prefStorage  ///< [IN] The preferred SMS storage area
+    SmsServerConnection_t* connPtr,             ///< [IN] Connection the PDUs were received on
+    const pa_sms_SimuBatchResult_t* resultPtr,  ///< [IN] Result of each PDU
+    uint32_t count                              ///< [IN] Number of PDUs
 )
 {
-    if ((prefStorage != LE_SMS_STORAGE_SIM) && (prefStorage != LE_SMS_STORAGE_NV))
+    pa_sms_SimuPdu_t* framePtr;
+
+    if (!connPtr->deliveryReports)
     {
-        return LE_FAULT;
+        return;
     }
 
-    PrefSmsStorage = prefStorage;
-    return LE_OK;
+    framePtr = le_mem_ForceAlloc(SmsBatchFramePool);
+    memset(framePtr, 0, sizeof(pa_sms_SimuPdu_t));
+    framePtr->protocol = PA_SIMU_SMS_FRAME_DELIVERED;
+    framePtr->dataLen = count * sizeof(pa_sms_SimuBatchResult_t);
+    memcpy(framePtr->data, resultPtr, framePtr->dataLen);
+
+    le_mem_AddRef(connPtr);
+    le_event_QueueFunction(SmsServerSendDeliveryReport, connPtr, framePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a batch of PDUs received on a socket connection.
+ *
+ * Each PDU is stored as an incoming message, the new message indications are reported in one go
+ * and a single acknowledgement with the result of each PDU is sent back to the client.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsServerHandleBatch
+(
+    SmsServerConnection_t* connPtr,     ///< [IN] Connection the batch was received on
+    pa_sms_SimuPdu_t* framePtr          ///< [IN] Received batch frame
+)
+{
+    pa_sms_SimuPdu_t* ackPtr = le_mem_ForceAlloc(SmsBatchFramePool);
+    pa_sms_SimuBatchResult_t* resultPtr = (pa_sms_SimuBatchResult_t*)ackPtr->data;
+    SmsNewMsgBatch_t* batchPtr = le_mem_ForceAlloc(SmsNewMsgBatchPool);
+    bool isOnline = mrc_simu_IsOnline();
+    uint32_t offset = 0;
+    uint32_t pduCnt = 0;
+
+    batchPtr->count = 0;
+
+    while ((offset < framePtr->dataLen) && (pduCnt < PA_SIMU_SMS_MAX_BATCH_CNT))
+    {
+        pa_sms_SimuPdu_t* pduPtr = (pa_sms_SimuPdu_t*)(framePtr->data + offset);
+        pa_sms_SimuBatchResult_t* pduResultPtr = &resultPtr[pduCnt++];
+
+        memset(pduResultPtr, 0, sizeof(pa_sms_SimuBatchResult_t));
+
+        if (((framePtr->dataLen - offset) < sizeof(pa_sms_SimuPdu_t)) ||
+            (pduPtr->protocol >= PA_SIMU_SMS_FRAME_BATCH) ||
+            (pduPtr->dataLen > PA_SIMU_SMS_MAX_PDU_DATA_LEN) ||
+            ((framePtr->dataLen - offset - sizeof(pa_sms_SimuPdu_t)) < pduPtr->dataLen))
+        {
+            LE_ERROR("Malformed PDU %u in batch on conn[%u]", pduCnt - 1, connPtr->id);
+            pduResultPtr->result = LE_FORMAT_ERROR;
+            break;
+        }
+
+        offset += sizeof(pa_sms_SimuPdu_t) + pduPtr->dataLen;
+
+        if (!isOnline)
+        {
+            pduResultPtr->result = LE_NOT_POSSIBLE;
+            continue;
+        }
+
+        pduResultPtr->result = SmsServerStoreRemoteMessage(framePtr, pduPtr,
+                                            &(batchPtr->indications[batchPtr->count]));
+        if (LE_OK == pduResultPtr->result)
+        {
+            pduResultPtr->storage = batchPtr->indications[batchPtr->count].storage;
+            pduResultPtr->index = batchPtr->indications[batchPtr->count].msgIndex;
+            batchPtr->count++;
+        }
+    }
+
+    LE_DEBUG("Batch of %u PDUs on conn[%u], %u stored", pduCnt, connPtr->id, batchPtr->count);
+
+    if (batchPtr->count > 0)
+    {
+        le_event_QueueFunction(SmsDispatchNewMsgBatch, batchPtr, NULL);
+    }
+    else
+    {
+        le_mem_Release(batchPtr);
+    }
+
+    SmsServerQueueDeliveryReport(connPtr, resultPtr, pduCnt);
+
+    memset(ackPtr, 0, sizeof(pa_sms_SimuPdu_t));
+    ackPtr->protocol = PA_SIMU_SMS_FRAME_BATCH_ACK;
+    ackPtr->dataLen = pduCnt * sizeof(pa_sms_SimuBatchResult_t);
+    SmsServerSendFrame(connPtr, ackPtr);
+    le_mem_Release(ackPtr);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function is called to get the preferred SMS storage area.
- *
- * @return LE_OK            The function succeeded.
+ * Handle one complete frame received on a socket connection.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_GetPreferredStorage
+static void SmsServerHandleFrame
 (
-    le_sms_Storage_t* prefStoragePtr  ///< [OUT] The preferred SMS storage area
+    SmsServerConnection_t* connPtr,     ///< [IN] Connection the frame was received on
+    pa_sms_SimuPdu_t* framePtr          ///< [IN] Received frame
 )
 {
-    *prefStoragePtr = PrefSmsStorage;
-    return LE_OK;
+    pa_sms_SimuBatchResult_t result;
+    pa_sms_NewMessageIndication_t msgIndication;
+
+    connPtr->rxMsgCnt++;
+
+    switch ((uint32_t)framePtr->protocol)
+    {
+        case PA_SIMU_SMS_FRAME_BATCH:
+            SmsServerHandleBatch(connPtr, framePtr);
+            return;
+
+        case PA_SIMU_SMS_FRAME_DELIVERY_REPORTS:
+            LE_INFO("Delivery reports enabled on conn[%u]", connPtr->id);
+            connPtr->deliveryReports = true;
+            return;
+
+        case PA_SIMU_SMS_FRAME_CELL_BROADCAST:
+            memset(&result, 0, sizeof(result));
+            result.result = SmsServerHandleCellBroadcast(framePtr);
+            result.storage = PA_SMS_STORAGE_NONE;
+            SmsServerQueueDeliveryReport(connPtr, &result, 1);
+            return;
+
+        case PA_SIMU_SMS_FRAME_CONCAT:
+            // The segments are stored later, with the simulated delay
+            memset(&result, 0, sizeof(result));
+            result.result = SmsServerHandleConcat(framePtr);
+            result.storage = PA_SMS_STORAGE_NONE;
+            SmsServerQueueDeliveryReport(connPtr, &result, 1);
+            return;
+
+        case PA_SIMU_SMS_FRAME_CONCAT_REASSEMBLY:
+            LE_INFO("Concatenated message reassembly enabled on conn[%u]", connPtr->id);
+            connPtr->concatReassembly = true;
+            return;
+
+        default:
+            break;
+    }
+
+    LE_DEBUG("Received message from '%s', to '%s' (len=%u) on conn[%u]",
+        framePtr->origAddress,
+        framePtr->destAddress,
+        framePtr->dataLen,
+        connPtr->id);
+
+    memset(&result, 0, sizeof(result));
+
+    if(!mrc_simu_IsOnline())
+    {
+        LE_WARN("Not handling message because we're offline.");
+        result.result = LE_NOT_POSSIBLE;
+    }
+    else
+    {
+        result.result = SmsServerHandleRemoteMessage(framePtr, &msgIndication);
+        if (LE_OK == result.result)
+        {
+            result.storage = msgIndication.storage;
+            result.index = msgIndication.msgIndex;
+        }
+    }
+
+    SmsServerQueueDeliveryReport(connPtr, &result, 1);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function must be called to register a handler for a new message reception handling.
- *
- * @return LE_OK            The function succeeded.
+ * Allocate the buffer receiving the next frames of a connection, from the PDU frame pool if it can
+ * hold the given number of bytes, from the batch frame pool otherwise.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_SetNewMsgHandler
+static void SmsServerAllocRxFrame
 (
-    pa_sms_NewMsgHdlrFunc_t msgHandler   ///< [IN] The handler function to handle a new message
-                                         ///       reception.
+    SmsServerConnection_t* connPtr, ///< [IN] Connection
+    size_t minSize                  ///< [IN] Minimum size of the buffer
 )
 {
-    NewSMSHandler = msgHandler;
-
-    NewSMSHandlerRef = le_event_AddHandler("NewSMSHandler",
-                                         EventNewSmsId,
-                                         (le_event_HandlerFunc_t) msgHandler);
-
-    return LE_OK;
+    if (minSize <= (sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN))
+    {
+        connPtr->rxFramePtr = le_mem_ForceAlloc(SmsPduFramePool);
+        connPtr->rxSize = sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN;
+    }
+    else
+    {
+        connPtr->rxFramePtr = le_mem_ForceAlloc(SmsBatchFramePool);
+        connPtr->rxSize = sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_BATCH_DATA_LEN;
+    }
+    connPtr->rxLen = 0;
+    connPtr->rxHeaderChecked = false;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function must be called to unregister the handler for a new message reception handling.
+ * Check the header of the frame being received on a connection, once complete.
  *
- * @return LE_OK            The function succeeded.
+ * Frames that do not fit in their buffer, e.g. batches and cell broadcasts received in a PDU frame
+ * buffer, have the bytes received so far moved to a batch frame buffer.
+ *
+ * @return LE_FORMAT_ERROR The header is not valid.
+ * @return LE_OK           The function succeeded.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_ClearNewMsgHandler
+static le_result_t SmsServerCheckHeader
 (
-    void
+    SmsServerConnection_t* connPtr  ///< [IN] Connection
 )
 {
-    le_event_RemoveHandler(NewSMSHandlerRef);
-    NewSMSHandlerRef = NULL;
+    pa_sms_SimuPdu_t* framePtr = connPtr->rxFramePtr;
+    size_t maxDataLen;
+
+    switch ((uint32_t)framePtr->protocol)
+    {
+        case PA_SIMU_SMS_FRAME_BATCH:
+            maxDataLen = PA_SIMU_SMS_MAX_BATCH_DATA_LEN;
+            break;
+
+        case PA_SIMU_SMS_FRAME_CELL_BROADCAST:
+            maxDataLen = PA_SIMU_SMS_MAX_CB_DATA_LEN;
+            break;
+
+        case PA_SIMU_SMS_FRAME_CONCAT:
+            maxDataLen = PA_SIMU_SMS_MAX_CONCAT_DATA_LEN;
+            break;
+
+        default:
+            maxDataLen = PA_SIMU_SMS_MAX_PDU_DATA_LEN;
+            break;
+    }
+
+    if (framePtr->dataLen > maxDataLen)
+    {
+        LE_ERROR("Invalid frame length %u on conn[%u]", framePtr->dataLen, connPtr->id);
+        return LE_FORMAT_ERROR;
+    }
+
+    if ((sizeof(pa_sms_SimuPdu_t) + framePtr->dataLen) > connPtr->rxSize)
+    {
+        size_t rxLen = connPtr->rxLen;
+
+        SmsServerAllocRxFrame(connPtr, sizeof(pa_sms_SimuPdu_t) + framePtr->dataLen);
+        memcpy(connPtr->rxFramePtr, framePtr, rxLen);
+        connPtr->rxLen = rxLen;
+        le_mem_Release(framePtr);
+    }
+    connPtr->rxHeaderChecked = true;
+
     return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Set the new SMS to be received in storage
+ * Handle the frame received at the start of the buffer of a connection, then release it.
  *
+ * The stored messages keep their own reference on the frame buffer. The bytes of the next frames,
+ * received along with this one, are moved to a new buffer, unless this frame is small enough to be
+ * moved to a PDU frame buffer itself: a batch frame buffer is then kept for the next frames.
  */
 //--------------------------------------------------------------------------------------------------
-void pa_sms_SetSmsInStorage
+static void SmsServerCompleteFrame
 (
-   pa_sms_NewMessageIndication_t* msgPtr
+    SmsServerConnection_t* connPtr, ///< [IN] Connection
+    size_t frameLen                 ///< [IN] Length of the frame, header included
 )
 {
-    int i;
-    int storageIdx = msgPtr->storage;
-    int index = msgPtr->msgIndex;
-    SmsMsgInMemory* storageMsgPtr = NULL;
+    pa_sms_SimuPdu_t* framePtr = connPtr->rxFramePtr;
+    size_t nextLen = connPtr->rxLen - frameLen;
 
-    if (storageIdx == PA_SMS_STORAGE_NV)
-    {
-        NumberSmsInStorageNv++;
-        LE_DEBUG("NumberSmsInStorageNv %d ", NumberSmsInStorageNv);
-        storageMsgPtr = &SmsMem[storageIdx-1][index];
-    }
-    else if (storageIdx == PA_SMS_STORAGE_SIM)
-    {
-        NumberSmsInStorageSim++;
-        LE_DEBUG("NumberSmsInStorageSim %d ", NumberSmsInStorageSim);
-        storageMsgPtr = &SmsMem[storageIdx-1][index];
-    }
-    else if (storageIdx == PA_SMS_STORAGE_NONE)
-    {
-        NumberSmsInStorageNone++;
-        LE_DEBUG("NumberSmsInStorageNone %d ", NumberSmsInStorageNone);
-    }
-    else
+    if ((nextLen > (sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN)) &&
+        (frameLen <= (sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN)))
     {
-        LE_FATAL("Unknown storage index %d", msgPtr->storage);
+        framePtr = le_mem_ForceAlloc(SmsPduFramePool);
+        memcpy(framePtr, connPtr->rxFramePtr, frameLen);
+        memmove(connPtr->rxFramePtr, (uint8_t*)connPtr->rxFramePtr + frameLen, nextLen);
+        connPtr->rxLen = nextLen;
+        connPtr->rxHeaderChecked = false;
+
+        SmsServerHandleFrame(connPtr, framePtr);
+        le_mem_Release(framePtr);
+        return;
     }
 
-    if(storageMsgPtr)
+    connPtr->rxFramePtr = NULL;
+    connPtr->rxLen = 0;
+
+    if (nextLen > 0)
     {
-        storageMsgPtr->pduContent.status = LE_SMS_RX_UNREAD;
-        storageMsgPtr->pduContent.protocol = msgPtr->protocol;
-        storageMsgPtr->pduContent.dataLen = msgPtr->pduLen;
-        for (i=0; i< msgPtr->pduLen; i++)
-        {
-            storageMsgPtr->pduContent.data[i] = msgPtr->pduCB[i];
-        }
+        SmsServerAllocRxFrame(connPtr, nextLen);
+        memcpy(connPtr->rxFramePtr, (uint8_t*)framePtr + frameLen, nextLen);
+        connPtr->rxLen = nextLen;
     }
 
-    NewSMSHandler(msgPtr);
+    SmsServerHandleFrame(connPtr, framePtr);
+    le_mem_Release(framePtr);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Set the error code
+ * Handle all the complete frames received on a connection.
  *
+ * @return LE_FORMAT_ERROR A frame header is not valid.
+ * @return LE_OK           The function succeeded.
  */
 //--------------------------------------------------------------------------------------------------
-void pa_sms_SetSmsErrCause
+static le_result_t SmsServerParseFrames
 (
-   int errorCode
+    SmsServerConnection_t* connPtr  ///< [IN] Connection
 )
 {
-    SmsSendErrorCause = errorCode;
+    while ((NULL != connPtr->rxFramePtr) && (connPtr->rxLen >= sizeof(pa_sms_SimuPdu_t)))
+    {
+        size_t frameLen;
+
+        if ((!connPtr->rxHeaderChecked) && (LE_OK != SmsServerCheckHeader(connPtr)))
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        frameLen = sizeof(pa_sms_SimuPdu_t) + connPtr->rxFramePtr->dataLen;
+        if (connPtr->rxLen < frameLen)
+        {
+            break;
+        }
+
+        SmsServerCompleteFrame(connPtr, frameLen);
+    }
+
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Set the type of storage in case of full storage indication
+ * Read the messages incoming on a socket connection.
  *
+ * Each read fills as much of the current frame buffer as the socket allows, then all the complete
+ * frames are handled from the buffer. A frame at the start of its buffer is referenced by the
+ * storage without any copy. The socket is drained up to PA_SMS_SIMU_RX_BUDGET reads, then the
+ * hand is given back to the event loop so that all the connections are serviced in turn.
  */
 //--------------------------------------------------------------------------------------------------
-void pa_sms_SetFullStorageType
+static void SmsServerRead
 (
-    int storage_type
+    SmsServerConnection_t* connPtr      ///< [IN] Connection
 )
 {
-    // Init the data for the event report
-    pa_sms_StorageStatusInd_t storageStatus;
-    memset(&storageStatus, 0, sizeof(pa_sms_StorageStatusInd_t));
+    int connFd = connPtr->fd;
+    int budget;
 
-    switch(storage_type)
+    for (budget = PA_SMS_SIMU_RX_BUDGET; budget > 0; budget--)
     {
-        case SIMU_SMS_STORAGE_NV:
+        size_t freeSz;
+        ssize_t readSz;
+
+        if (NULL == connPtr->rxFramePtr)
         {
-            storageStatus.storage = PA_SMS_STORAGE_NV;
+            SmsServerAllocRxFrame(connPtr, sizeof(pa_sms_SimuPdu_t));
         }
-        break;
 
-        case SIMU_SMS_STORAGE_SIM:
+        freeSz = connPtr->rxSize - connPtr->rxLen;
+        readSz = recv(connFd, (uint8_t*)connPtr->rxFramePtr + connPtr->rxLen, freeSz,
+                      MSG_DONTWAIT);
+        if (readSz < 0)
         {
-            storageStatus.storage = PA_SMS_STORAGE_SIM;
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                return;
+            }
+
+            LE_ERROR("Error on reception for conn[%u]: %m", connPtr->id);
+            SmsServerCloseConnection(connPtr);
+            return;
         }
-        break;
 
-        default:
+        if (readSz == 0)
         {
-            storageStatus.storage = PA_SMS_STORAGE_UNKNOWN;
+            LE_INFO("Client has disconnected (conn[%u] fd=%d)", connPtr->id, connFd);
+            SmsServerCloseConnection(connPtr);
+            return;
+        }
+
+        LE_DEBUG("Read %zd bytes (conn[%u] fd=%d)", readSz, connPtr->id, connFd);
+
+        connPtr->rxLen += readSz;
+        if (LE_OK != SmsServerParseFrames(connPtr))
+        {
+            SmsServerCloseConnection(connPtr);
+            return;
+        }
+
+        if ((size_t)readSz < freeSz)
+        {
+            // Socket drained, wait for the next frames
+            return;
         }
     }
-    StorageMsgHdlr(&storageStatus);
 }
 
-
 //--------------------------------------------------------------------------------------------------
 /**
- *
- * This function is used to add a status SMS storage notification handler
- *
- * @return A handler reference, which is only needed for later removal of the handler.
+ * Event handler of a socket connection.
  */
 //--------------------------------------------------------------------------------------------------
-le_event_HandlerRef_t pa_sms_AddStorageStatusHandler
+static void SmsServerConnEvent
 (
-    pa_sms_StorageMsgHdlrFunc_t statusHandler   ///< [IN] The handler function to handle a status
-                                                ///  notification reception.
+    int connFd,
+    short events
 )
 {
-    // event mechanism is not used because le_event_RunLoop isn't reached
-    StorageMsgHdlr = statusHandler;
+    SmsServerConnection_t* connPtr = le_fdMonitor_GetContextPtr();
 
-    return (le_event_HandlerRef_t) StorageMsgHdlr;
-}
+    LE_ASSERT(connPtr != NULL);
+
+    if (connPtr->txFailed)
+    {
+        LE_INFO("Closing connection[%u] after send failure (fd=%d)", connPtr->id, connFd);
+        SmsServerCloseConnection(connPtr);
+        return;
+    }
 
+    if (events & POLLOUT)
+    {
+        if (LE_OK != SmsServerFlush(connPtr))
+        {
+            SmsServerCloseConnection(connPtr);
+            return;
+        }
+    }
 
-//--------------------------------------------------------------------------------------------------
-/**
- * This function is called to unregister from a storage message notification handler.
- */
-//--------------------------------------------------------------------------------------------------
-void pa_sms_RemoveStorageStatusHandler
-(
-    le_event_HandlerRef_t storageHandler
-)
-{
-    le_event_RemoveHandler(storageHandler);
+    if (events & POLLIN)
+    {
+        SmsServerRead(connPtr);
+    }
+    else if (!(events & POLLOUT))
+    {
+        LE_INFO("Connection[%u] closed by peer (fd=%d, events=0x%x)", connPtr->id, connFd, events);
+        SmsServerCloseConnection(connPtr);
+    }
 }
 
-
 //--------------------------------------------------------------------------------------------------
 /**
- * This function sends a message in PDU mode.
- *
- * @return LE_OK              The function succeeded.
- * @return LE_FAULT           The function failed to send a message in PDU mode.
- * @return LE_TIMEOUT         No response was received from the Modem.
- * @return a positive value   The function succeeded. The value represents the message reference.
+ * Handle an incoming socket connection.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_SendPduMsg
+static void SmsServerConn
 (
-    pa_sms_Protocol_t        protocol,   ///< [IN] protocol to use
-    uint32_t                 length,     ///< [IN] The length of the TP data unit in bytes.
-    const uint8_t*           dataPtr,    ///< [IN] The message.
-    uint8_t*                 msgRef,     ///< [OUT] Message reference (TP-MR)
-    uint32_t                 timeout,    ///< [IN] Timeout in seconds.
-    pa_sms_SendingErrCode_t* errorCode   ///< [OUT] The error code.
+    int listenFd
 )
 {
-    le_result_t res;
-    union {
-        pa_sms_SimuPdu_t header;
-        char buffer[1024];
-    } txBuffer;
+    int connFd;
+    struct sockaddr_storage inAddr;
+    socklen_t inLen = sizeof(inAddr);
+    char monitorFdName[100];
+    SmsServerConnection_t* connPtr;
 
-    if (!mrc_simu_IsOnline())
+    LE_INFO("Conn listenFd=%d", listenFd);
+
+    connFd = accept(listenFd, (struct sockaddr*)&inAddr, &inLen);
+    if (connFd < 0)
     {
-        LE_WARN("Not sending message because we're offline.");
-        return LE_FAULT;
+        LE_ERROR("Unable to accept connection: %m");
+        return;
     }
 
-    LE_INFO("Sending PDU message (length=%u protocol=%u)", length, protocol);
-
-    txBuffer.header.protocol = protocol;
-
-    res = pa_sim_GetSubscriberPhoneNumber( (char *)txBuffer.header.origAddress, LE_MDMDEFS_PHONE_NUM_MAX_LEN);
-    LE_FATAL_IF(res != LE_OK, "Unable to get subscriber phone number.");
-
-    txBuffer.header.destAddress[0] = '\0';
-
-    if ( length >= (sizeof(txBuffer) - offsetof(pa_sms_SimuPdu_t, data)) )
+    if (SmsServerConnectionCnt >= SmsServerMaxConnections)
     {
-        LE_WARN("PDU message is too big");
-        return LE_OUT_OF_RANGE;
+        // Accept and close right away, otherwise the listen socket would stay readable.
+        LE_WARN("Nb of allowed connections reached (%u)", SmsServerMaxConnections);
+        close(connFd);
+        return;
     }
 
-    txBuffer.header.dataLen = length;
-    memcpy(txBuffer.header.data, dataPtr, length);
+    // Never block the event loop on a slow client
+    if (fcntl(connFd, F_SETFL, fcntl(connFd, F_GETFL) | O_NONBLOCK) < 0)
+    {
+        LE_ERROR("Unable to make connection non-blocking: %m");
+        close(connFd);
+        return;
+    }
 
-    SmsServerHandleLocalMessage( &(txBuffer.header) );
+    connPtr = le_mem_ForceAlloc(SmsServerConnectionPool);
+    memset(connPtr, 0, sizeof(SmsServerConnection_t));
+    connPtr->link = LE_DLS_LINK_INIT;
+    connPtr->txQueue = LE_DLS_LIST_INIT;
+    connPtr->id = SmsServerConnectionNextId++;
+    connPtr->fd = connFd;
 
-    LE_INFO("SmsSendErrorCause %d", SmsSendErrorCause);
+    LE_INFO("Accept Connection[%u] fd=%d", connPtr->id, connFd);
 
-    *msgRef = SMSMessageReference;
+    snprintf(monitorFdName, sizeof(monitorFdName), "SmsSimuConn[%u]", connPtr->id);
 
-    // Increment the Message reference (TP-MR).
-    SMSMessageReference++;
+    connPtr->fdMonitorRef = le_fdMonitor_Create(monitorFdName,
+                                                connFd,
+                                                SmsServerConnEvent,
+                                                POLLIN);
+    le_fdMonitor_SetContextPtr(connPtr->fdMonitorRef, connPtr);
 
-    // error cause
-    return  SmsSendErrorCause;
+    le_dls_Queue(&SmsServerConnections, &(connPtr->link));
+    SmsServerConnectionCnt++;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function gets the message from the preferred message storage.
- *
- * @return LE_FAULT        The function failed to get the message from the preferred message
- *                         storage.
- * @return LE_OK           The function succeeded.
+ * Handle an error on the socket connection.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_RdPDUMsgFromMem
+static void SmsServerError
 (
-    uint32_t            index,      ///< [IN]  The place of storage in memory.
-    pa_sms_Protocol_t   protocol,   ///< [IN] The protocol used for this message
-    pa_sms_Storage_t    storage,    ///< [IN] SMS Storage used
-    pa_sms_Pdu_t*       msgPtr      ///< [OUT] The message.
+    void
 )
 {
-    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
+    LE_FATAL("SMS Server Error");
+}
 
-    if (NULL == smsMsgPtr)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Event handler for file descriptor events for the SMS server listen socket.
+ **/
+//--------------------------------------------------------------------------------------------------
+static void SmsServerListenEvent
+(
+    int fd,         ///< Socket file descriptor.
+    short events    ///< Bit map of events.  Expect POLLIN (readable) and POLLERR (error).
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (events & POLLERR)
     {
-        LE_ERROR("Trying to access invalid SMS storage storage[%u] index[%u]", storage, index);
-        return LE_FAULT;
+        SmsServerError();
     }
 
-    if (LE_SMS_STATUS_UNKNOWN == smsMsgPtr->pduContent.status)
+    if (events & POLLIN)
     {
-        return LE_FAULT;
+        SmsServerConn(fd);
     }
-
-    memcpy(msgPtr, &(smsMsgPtr->pduContent), sizeof(pa_sms_Pdu_t));
-
-    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function gets the indexes of messages stored in the preferred memory for a specific
- * status.
+ * Create and bind the Unix domain socket of the SMS server.
  *
- * @return LE_OK             The function succeeded.
+ * @return The socket, or -1 on error.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_ListMsgFromMem
+static int OpenUnixSocket
 (
-    le_sms_Status_t     status,     ///< [IN] The status of message in memory.
-    pa_sms_Protocol_t   protocol,   ///< [IN] The protocol to read
-    uint32_t           *numPtr,     ///< [OUT] The number of indexes retrieved.
-    uint32_t           *idxPtr,     ///< [OUT] The pointer to an array of indexes.
-                                    ///        The array is filled with 'num' index values.
-    pa_sms_Storage_t    storage     ///< [IN] SMS Storage used
+    void
 )
 {
-    if (storage == PA_SMS_STORAGE_NV)
+    struct sockaddr_un sockAddr;
+    size_t pathLen = strlen(SmsServerUnixPath);
+    socklen_t addrLen;
+    int fd;
+
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sun_family = AF_UNIX;
+    memcpy(sockAddr.sun_path, SmsServerUnixPath, pathLen);
+
+    if ('@' == SmsServerUnixPath[0])
     {
-        if (status == LE_SMS_RX_UNREAD)
-        {
-            *numPtr = NumberSmsInStorageNv;
-            LE_DEBUG("NumberSmsInStorageNv %d ",NumberSmsInStorageNv);
-        }
-        else
-        {
-            *numPtr = 0;
-        }
+        // Abstract namespace: the name is not NUL-terminated and its length is the address length
+        sockAddr.sun_path[0] = '\0';
+        addrLen = offsetof(struct sockaddr_un, sun_path) + pathLen;
     }
-    else if (storage == PA_SMS_STORAGE_SIM)
+    else
     {
-        if (status == LE_SMS_RX_UNREAD)
-        {
-            *numPtr = NumberSmsInStorageSim;
-            LE_DEBUG("NumberSmsInStorageSim %d ",NumberSmsInStorageSim);
-        }
-        else
+        // Remove the socket left by a previous instance
+        if ((0 != unlink(SmsServerUnixPath)) && (ENOENT != errno))
         {
-            *numPtr = 0;
+            LE_WARN("Unable to remove '%s' (%m)", SmsServerUnixPath);
         }
+        addrLen = offsetof(struct sockaddr_un, sun_path) + pathLen + 1;
     }
-    else if (storage == PA_SMS_STORAGE_NONE)
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
     {
-        if (status == LE_SMS_RX_UNREAD)
-        {
-            *numPtr = NumberSmsInStorageNone;
-            LE_DEBUG("NumberSmsInStorageNone %d ",NumberSmsInStorageNone);
-        }
-        else
-        {
-            *numPtr = 0;
-        }
+        LE_ERROR("Error when creating socket (%m)");
+        return -1;
     }
-    else
+
+    if (bind(fd, (struct sockaddr*)&sockAddr, addrLen) < 0)
     {
-        *numPtr = 0;
+        LE_ERROR("Error when binding socket to '%s' (%m)", SmsServerUnixPath);
+        close(fd);
+        return -1;
     }
 
-    return LE_OK;
+    if ('@' != SmsServerUnixPath[0])
+    {
+        le_utf8_Copy(SmsServerBoundPath, SmsServerUnixPath, sizeof(SmsServerBoundPath), NULL);
+    }
+
+    LE_INFO("SMS Server on unix socket '%s' (listenFd=%d)", SmsServerUnixPath, fd);
+    return fd;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function deletes one specific Message from preferred message storage.
+ * Create and bind the TCP socket of the SMS server.
  *
- * @return LE_FAULT          The function failed to delete one specific Message from preferred
- *                           message storage.
- * @return LE_OK             The function succeeded.
+ * Without bind address, the socket is bound to all the IPv4 addresses. Otherwise the first address
+ * the bind address resolves to is used, IPv4 or IPv6.
+ *
+ * @return The socket, or -1 on error.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_DelMsgFromMem
+static int OpenTcpSocket
 (
-    uint32_t            index,    ///< [IN] Index of the message to be deleted.
-    pa_sms_Protocol_t   protocol, ///< [IN] protocol
-    pa_sms_Storage_t    storage   ///< [IN] SMS Storage used
+    void
 )
 {
-    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
+    struct addrinfo hints;
+    struct addrinfo* addrInfoPtr;
+    struct sockaddr_storage boundAddr;
+    socklen_t boundLen = sizeof(boundAddr);
+    char portStr[6];
+    char hostStr[NI_MAXHOST];
+    char servStr[NI_MAXSERV];
+    const char* nodePtr = ('\0' == SmsServerBindAddress[0]) ? NULL : SmsServerBindAddress;
+    int reuse = 1;
+    int fd;
+    int res;
 
-    LE_DEBUG("Deleting message storage[%u] index[%u]", storage, index);
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = (NULL == nodePtr) ? AF_INET : AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    snprintf(portStr, sizeof(portStr), "%u", SmsServerPort);
 
-    if (NULL == smsMsgPtr)
+    res = getaddrinfo(nodePtr, portStr, &hints, &addrInfoPtr);
+    if (0 != res)
     {
-        return LE_FAULT;
+        LE_ERROR("Unable to resolve bind address '%s' (%s)",
+                 SmsServerBindAddress, gai_strerror(res));
+        return -1;
     }
 
-    smsMsgPtr->pduContent.status = LE_SMS_STATUS_UNKNOWN;
+    fd = socket(addrInfoPtr->ai_family, addrInfoPtr->ai_socktype, addrInfoPtr->ai_protocol);
+    if (fd < 0)
+    {
+        LE_ERROR("Error when creating socket (%m)");
+        freeaddrinfo(addrInfoPtr);
+        return -1;
+    }
 
-    if (storage == PA_SMS_STORAGE_NV)
+    // Allow a restarted simulator to bind the port right away
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
     {
-        NumberSmsInStorageNv--;
-        LE_DEBUG("NumberSmsInStorageNv %d ",NumberSmsInStorageNv);
+        LE_WARN("Unable to set SO_REUSEADDR (%m)");
     }
-    else if (storage == PA_SMS_STORAGE_SIM)
+
+    res = bind(fd, addrInfoPtr->ai_addr, addrInfoPtr->ai_addrlen);
+    freeaddrinfo(addrInfoPtr);
+    if (res < 0)
     {
-        NumberSmsInStorageSim--;
-        LE_DEBUG("NumberSmsInStorageSim %d ",NumberSmsInStorageSim);
+        LE_ERROR("Error when binding socket to '%s' port %u (%m)",
+                 SmsServerBindAddress, SmsServerPort);
+        close(fd);
+        return -1;
     }
-    else if (storage == PA_SMS_STORAGE_NONE)
+
+    // Log the actual address, the port is chosen by the system if configured to 0
+    if ((0 == getsockname(fd, (struct sockaddr*)&boundAddr, &boundLen)) &&
+        (0 == getnameinfo((struct sockaddr*)&boundAddr, boundLen, hostStr, sizeof(hostStr),
+                          servStr, sizeof(servStr), NI_NUMERICHOST | NI_NUMERICSERV)))
     {
-        NumberSmsInStorageNone--;
-        LE_DEBUG("NumberSmsInStorageNone %d ",NumberSmsInStorageNone);
+        LE_INFO("SMS Server on %s port %s (listenFd=%d)", hostStr, servStr, fd);
     }
-    return LE_OK;
+
+    return fd;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function deletes all Messages from preferred message storage.
+ * Initialize SMS server on the configured transport.
  *
+ * @return LE_FAULT        The server socket could not be created.
  * @return LE_OK           The function succeeded.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_DelAllMsg
+static le_result_t InitSmsServer
 (
     void
 )
 {
-    pa_sms_Storage_t storage;
-    uint32_t idx;
-    SmsMsgInMemory * smsMsgPtr;
+    int fd;
 
-    for(storage = PA_SMS_STORAGE_NV; storage <= PA_SMS_STORAGE_SIM; storage++)
+    if ('\0' != SmsServerUnixPath[0])
     {
-        for(idx = 0; idx < PA_SMS_SIMU_MAX_MSG_IN_MEM; idx++)
-        {
-            smsMsgPtr = GetSmsMsg(storage, idx);
-            LE_ASSERT(smsMsgPtr != NULL);
-            smsMsgPtr->pduContent.status = LE_SMS_STATUS_UNKNOWN;
-        }
+        fd = OpenUnixSocket();
+    }
+    else
+    {
+        fd = OpenTcpSocket();
     }
 
-    return LE_OK;
-}
-
-//--------------------------------------------------------------------------------------------------
-/**
- * This function changes the message status.
- *
- * @return LE_FAULT        The function failed.
- * @return LE_OK           The function succeeded.
- */
-//--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_ChangeMessageStatus
-(
-    uint32_t            index,    ///< [IN] Index of the message to be deleted.
-    pa_sms_Protocol_t   protocol, ///< [IN] protocol
-    le_sms_Status_t     status,   ///< [IN] The status of message in memory.
-    pa_sms_Storage_t    storage   ///< [IN] SMS Storage used
-)
-{
-    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(storage, index);
-
-    if (NULL == smsMsgPtr)
+    if (fd < 0)
     {
         return LE_FAULT;
     }
 
-    LE_DEBUG("Changing message status storage[%u] index[%u] status [%u] -> [%u]",
-        storage, index, smsMsgPtr->pduContent.status, status);
+    if (listen(fd, 1024) < 0)
+    {
+        LE_ERROR("Error when starting to listen on socket (%m)");
+        close(fd);
+        return LE_FAULT;
+    }
 
-    smsMsgPtr->pduContent.status = status;
+    SmsServerListenFd = fd;
+    SmsServerMonitorRef = le_fdMonitor_Create("SmsSimuFd",
+                                              SmsServerListenFd,
+                                              SmsServerListenEvent,
+                                              POLLIN);
     return LE_OK;
 }
 
-
 //--------------------------------------------------------------------------------------------------
 /**
- * This function must be called to get the SMS center.
- *
- * @return
- *   - LE_FAULT        The function failed.
- *   - LE_OK           The function succeeded.
+ * Stop listening for new connections. The connections already accepted are kept.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_GetSmsc
+static void CloseSmsServer
 (
-    char*        smscPtr,  ///< [OUT] The Short message service center string.
-    size_t       len       ///< [IN] The length of SMSC string.
+    void
 )
 {
-    return le_utf8_Copy(smscPtr, SmsSmsc, len, NULL);
+    if (NULL != SmsServerMonitorRef)
+    {
+        le_fdMonitor_Delete(SmsServerMonitorRef);
+        SmsServerMonitorRef = NULL;
+    }
+
+    if (SmsServerListenFd >= 0)
+    {
+        close(SmsServerListenFd);
+        SmsServerListenFd = -1;
+    }
+
+    if ('\0' != SmsServerBoundPath[0])
+    {
+        unlink(SmsServerBoundPath);
+        SmsServerBoundPath[0] = '\0';
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function must be called to set the SMS center.
- *
- * @return LE_FAULT        The function failed.
- * @return LE_OK           The function succeeded.
+ * Restart the SMS server on the new transport, once all the settings of a configuration change
+ * have been applied.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_sms_SetSmsc
+static void RestartSmsServer
 (
-    const char*    smscPtr  ///< [IN] The Short message service center.
+    void* param1Ptr,    ///< [IN] Unused
+    void* param2Ptr     ///< [IN] Unused
 )
 {
-    return le_utf8_Copy(SmsSmsc, smscPtr, sizeof(SmsSmsc), NULL);
+    SmsServerRestartPending = false;
+
+    CloseSmsServer();
+    if (LE_OK != InitSmsServer())
+    {
+        LE_ERROR("SMS server not listening, fix the transport configuration");
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * De-allocate a message if it's not used anymore
+ * Restart the SMS server after a transport setting has changed, if it is already started.
  */
 //--------------------------------------------------------------------------------------------------
-static void SmsMemPoolDestructor
+static void ScheduleSmsServerRestart
 (
-    void* objPtr    ///< see parameter documentation in comment above.
+    void
 )
 {
-    SmsMsgRef * smsMsgRefPtr = (SmsMsgRef *)objPtr;
-    SmsMsgInMemory * smsMsgPtr = GetSmsMsg(smsMsgRefPtr->storage, smsMsgRefPtr->index);
-
-    LE_ASSERT(smsMsgPtr != NULL);
-
-    smsMsgPtr->pduContent.status = LE_SMS_STATUS_UNKNOWN;
+    if (SmsServerStarted && !SmsServerRestartPending)
+    {
+        SmsServerRestartPending = true;
+        le_event_QueueFunction(RestartSmsServer, NULL, NULL);
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function handle messages originating from the simulated world.
- *
- * @return LE_NO_MEMORY    There is no more memory available to handle this message.
- * @return LE_OK           The function succeeded.
+ * Set the TCP port of the SMS server.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t SmsServerHandleRemoteMessage
+static void SetPort
 (
-    pa_sms_SimuPdu_t * sourceMsgPtr
+    int32_t value           ///< [IN] Port number, 0 for a port chosen by the system
 )
 {
-    int idx;
-    SmsMsgInMemory * messageMemPtr = NULL; // Message stored in memory
-    SmsMsgRef * smsMsgRefPtr;
-    pa_sms_Storage_t storage = GetCurrentIncomingStorage();
-
-    /* Find free spot in memory & allocate */
-    for(idx = 0; idx < PA_SMS_SIMU_MAX_MSG_IN_MEM; idx++)
+    if ((value < 0) || (value > UINT16_MAX))
     {
-        messageMemPtr = GetSmsMsg(storage, idx);
-
-        LE_ASSERT(messageMemPtr != NULL);
-
-        if(messageMemPtr->pduContent.status == LE_SMS_STATUS_UNKNOWN)
-        {
-            messageMemPtr->pduContent.status = LE_SMS_RX_UNREAD;
-            break;
-        }
+        LE_ERROR("Invalid SMS server port %d", value);
+        return;
     }
 
-    if(idx == PA_SMS_SIMU_MAX_MSG_IN_MEM)
+    if (value != SmsServerPort)
     {
-        LE_WARN("No more spot available in memory to store this message.");
-        return LE_NO_MEMORY;
+        SmsServerPort = value;
+        ScheduleSmsServerRestart();
     }
-
-    /* Create a ref to hold the index */
-    smsMsgRefPtr = le_mem_ForceAlloc(SmsMemPoolRef);
-    smsMsgRefPtr->index = idx;
-    smsMsgRefPtr->storage = storage;
-
-    LE_DEBUG("New message at storage[%u] idx[%d] (%p)", storage, idx, messageMemPtr);
-
-    /* Store message */
-    messageMemPtr->pduContent.dataLen = sourceMsgPtr->dataLen;
-    memcpy(messageMemPtr->pduContent.data, sourceMsgPtr->data, sourceMsgPtr->dataLen);
-    messageMemPtr->pduContent.protocol = sourceMsgPtr->protocol;
-
-    /* Report index */    // Init the data for the event report
-    pa_sms_NewMessageIndication_t msgIndication = {0};
-    msgIndication.msgIndex = idx;
-    msgIndication.storage = storage;
-    msgIndication.protocol = sourceMsgPtr->protocol;
-
-    le_event_Report(EventNewSmsId, &msgIndication, sizeof(msgIndication));
-
-    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This function handle messages originating from the Legato world.
- *
- * @return LE_FAULT        There was an error when handling the message.
- * @return LE_OK           The function succeeded.
+ * Set the address the TCP socket of the SMS server is bound to.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t SmsServerHandleLocalMessage
+static void SetBindAddressFromString
 (
-    pa_sms_SimuPdu_t * sourceMsgPtr
+    const char* valueStr    ///< [IN] Host name or numeric address, empty for all addresses
 )
 {
-    int connIdx;
-    ssize_t writeSz, expectedWriteSz;
-
-    /* Deliver message to each connection */
-    for(connIdx = 0; connIdx < PA_SMS_SIMU_MAX_CONN; connIdx++)
-    {
-        int connFd = SmsServerConnections[connIdx].fd;
-        if(!SmsServerConnections[connIdx].used)
-            continue;
-
-        expectedWriteSz = sizeof(pa_sms_SimuPdu_t) + sourceMsgPtr->dataLen;
-        writeSz = send(connFd, sourceMsgPtr, expectedWriteSz, 0);
-        if(writeSz != expectedWriteSz)
-        {
-            LE_ERROR("Error while send message to fd=%d", connFd);
-        }
-    }
-
-    /* Deliver message locally if necessary */
-    {
-        pa_sms_Message_t decodedMessage;
-        le_result_t res;
-        char localNumber[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
-
-        res = pa_sim_GetSubscriberPhoneNumber(localNumber, LE_MDMDEFS_PHONE_NUM_MAX_BYTES);
-        if(res != LE_OK)
-        {
-            LE_ERROR("Unable to get subscriber phone number.");
-            return LE_FAULT;
-        }
-
-        res = smsPdu_Decode(sourceMsgPtr->protocol,
-                            sourceMsgPtr->data,
-                            sourceMsgPtr->dataLen,
-                            true,
-                            &decodedMessage);
-        if(res != LE_OK)
-        {
-            LE_ERROR("Unable to decode message.");
-            return LE_FAULT;
-        }
-
-        if(decodedMessage.type != PA_SMS_SUBMIT)
-        {
-            LE_ERROR("Unexpected type of PDU message.");
-            return LE_FAULT;
-        }
-
-        /* Destination and local number are the same */
-        if (0 == strncmp(decodedMessage.smsSubmit.da, localNumber, LE_MDMDEFS_PHONE_NUM_MAX_LEN))
-        {
-            pa_sms_Pdu_t pdu;
-            le_result_t res;
-            smsPdu_Encoding_t encoding;
-            smsPdu_DataToEncode_t data;
-
-            union {
-                pa_sms_SimuPdu_t header;
-                char buffer[1024];
-            } txBuffer;
-
-            switch (decodedMessage.smsSubmit.format)
-            {
-                case LE_SMS_FORMAT_BINARY:
-                case LE_SMS_FORMAT_PDU:
-                    encoding = SMSPDU_8_BITS;
-                    break;
-
-                case LE_SMS_FORMAT_TEXT:
-                    encoding = SMSPDU_7_BITS;
-                    break;
-
-                default:
-                    LE_ERROR("Unexpected format");
-                    return LE_FAULT;
-            }
-
-            LE_DEBUG("Sending message to self: len[%u] da[%s] format[%d] encoding[%d] protocol[%u]",
-                    decodedMessage.smsSubmit.dataLen,
-                    decodedMessage.smsSubmit.da,
-                    decodedMessage.smsSubmit.format,
-                    encoding,
-                    sourceMsgPtr->protocol);
-
-            memset(&data, 0, sizeof(data));
-            data.protocol = sourceMsgPtr->protocol;
-            data.messagePtr = decodedMessage.smsSubmit.data;
-            data.length = decodedMessage.smsSubmit.dataLen;
-            data.addressPtr = decodedMessage.smsSubmit.da;
-            data.encoding = encoding;
-            data.messageType = PA_SMS_DELIVER;
-            data.statusReport = false;
+    if (0 == strcmp(valueStr, SmsServerBindAddress))
+    {
+        return;
+    }
 
-            res = smsPdu_Encode(&data, &pdu);
-            if(res != LE_OK)
-            {
-                LE_ERROR("Unable to encode message.");
-                return LE_FAULT;
-            }
+    if (LE_OK != le_utf8_Copy(SmsServerBindAddress, valueStr, sizeof(SmsServerBindAddress), NULL))
+    {
+        LE_ERROR("SMS server bind address '%s' too long", valueStr);
+        SmsServerBindAddress[0] = '\0';
+    }
 
-            txBuffer.header.protocol = sourceMsgPtr->protocol;
-            strncpy((char *)txBuffer.header.origAddress, localNumber,
-                    sizeof(txBuffer.header.origAddress));
-            strncpy((char *)txBuffer.header.destAddress, localNumber,
-                    sizeof(txBuffer.header.destAddress));
+    ScheduleSmsServerRestart();
+}
 
-            txBuffer.header.dataLen = pdu.dataLen;
-            memcpy(txBuffer.header.data, pdu.data, pdu.dataLen);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the Unix domain socket of the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetUnixSocketFromString
+(
+    const char* valueStr    ///< [IN] Socket path, '@' prefix for abstract, empty for TCP
+)
+{
+    if (0 == strcmp(valueStr, SmsServerUnixPath))
+    {
+        return;
+    }
 
-            SmsServerHandleRemoteMessage( &(txBuffer.header) );
-        }
-        else
-        {
-            LE_DEBUG("Message not sent to self (='%s')", localNumber);
-        }
+    // The path must leave room for the terminating NUL of a filesystem socket
+    if (LE_OK != le_utf8_Copy(SmsServerUnixPath, valueStr, sizeof(SmsServerUnixPath), NULL))
+    {
+        LE_ERROR("SMS server unix socket '%s' too long", valueStr);
+        SmsServerUnixPath[0] = '\0';
     }
-    return LE_OK;
+
+    ScheduleSmsServerRestart();
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Read a message incoming on a socket connection.
+ * Get the counters of the receive path copies.
  */
 //--------------------------------------------------------------------------------------------------
-static void SmsServerRead
+void pa_smsSimu_GetCopyStats
 (
-    int connFd,
-    short events
+    pa_smsSimu_CopyStats_t* statsPtr    ///< [OUT] Counters
 )
 {
-    LE_ASSERT(events == POLLIN);
+    LE_ASSERT(NULL != statsPtr);
 
-    ssize_t readSz;
-    union {
-        pa_sms_SimuPdu_t header;
-        char buffer[1024];
-    } rxBuffer;
+    *statsPtr = SmsCopyStats;
+}
 
-    LE_INFO("Read (connFd=%d)", connFd);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the counters of the concatenated messages.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_smsSimu_GetConcatStats
+(
+    pa_smsSimu_ConcatStats_t* statsPtr  ///< [OUT] Counters
+)
+{
+    LE_ASSERT(NULL != statsPtr);
 
-    readSz = recv(connFd, rxBuffer.buffer, sizeof(rxBuffer.buffer), 0);
-    LE_FATAL_IF( (readSz < 0), "Error on reception");
+    *statsPtr = SmsConcatStats;
+}
 
-    if(readSz == 0)
-    {
-        int fdIndex;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalidate the cached subscriber phone number.
+ */
+//--------------------------------------------------------------------------------------------------
+void sms_simu_InvalidateLocalNumber
+(
+    void
+)
+{
+    LocalNumberValid = false;
+}
 
-        LE_INFO("Client has disconnected (fd=%d)", connFd);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the counters of the outbound pipeline.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_smsSimu_GetTxStats
+(
+    pa_smsSimu_TxStats_t* statsPtr      ///< [OUT] Counters
+)
+{
+    LE_ASSERT(NULL != statsPtr);
 
-        /* Find connection record */
-        for(fdIndex = 0; fdIndex < PA_SMS_SIMU_MAX_CONN; fdIndex++)
-        {
-            if(SmsServerConnections[fdIndex].fd == connFd)
-            {
-                LE_DEBUG("Releasing connection idx=%d fd=%d", fdIndex, connFd);
+    *statsPtr = SmsTxStats;
+}
 
-                le_fdMonitor_Delete(SmsServerConnections[fdIndex].fdMonitorRef);
+//--------------------------------------------------------------------------------------------------
+/**
+ * SMS Stub initialization.
+ *
+ * @return LE_OK           The function succeeded.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sms_simu_Init
+(
+    void
+)
+{
+    LE_INFO("PA SMS Init");
 
-                // Close the connection.
-                int result;
-                do
-                {
-                    result = close(connFd);
-                } while ((result == -1) && (errno == EINTR));
-                LE_CRIT_IF(result == -1, "close() failed for connection fd %d. Errno %m.", connFd);
+    LE_FATAL_IF(LE_OK != smsPdu_Initialize(), "Unable to init smsPdu");
 
-                // Clear out the connection record.
-                SmsServerConnections[fdIndex].fd = -1;
-                SmsServerConnections[fdIndex].fdMonitorRef = NULL;
-                SmsServerConnections[fdIndex].used = false;
+    EventNewSmsId = le_event_CreateId("EventNewSmsId", sizeof(pa_sms_NewMessageIndication_t));
 
-                break;
-            }
-        }
+    SmsServerConnectionPool = le_mem_CreatePool("SmsServerConnectionPool",
+                                                sizeof(SmsServerConnection_t));
+    SmsPduFramePool = le_mem_CreatePool("SmsPduFramePool",
+                                        sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN);
+    SmsBatchFramePool = le_mem_CreatePool("SmsBatchFramePool",
+                                          sizeof(pa_sms_SimuPdu_t) +
+                                          PA_SIMU_SMS_MAX_BATCH_DATA_LEN);
 
-        LE_FATAL_IF( (fdIndex == PA_SMS_SIMU_MAX_CONN), "Connection not found" );
-        return;
-    }
+    SmsServerTxEntryPool = le_mem_CreatePool("SmsServerTxEntryPool", sizeof(SmsServerTxEntry_t));
+    SmsPendingDeliveryPool = le_mem_CreatePool("SmsPendingDeliveryPool",
+                                               sizeof(SmsPendingDelivery_t));
+    SmsConcatReassemblyPool = le_mem_CreatePool("SmsConcatReassemblyPool",
+                                                sizeof(SmsConcatReassembly_t));
+    SmsConcatTimer = le_timer_Create("SmsConcatTimer");
+    le_timer_SetHandler(SmsConcatTimer, SmsConcatTimerHandler);
+    SmsDeliveryTimer = le_timer_Create("SmsDeliveryTimer");
+    le_timer_SetHandler(SmsDeliveryTimer, SmsDeliveryTimerHandler);
 
-    LE_FATAL_IF( (readSz < sizeof(pa_sms_SimuPdu_t)), "Received size < size of header" );
+    SmsNewMsgBatchPool = le_mem_CreatePool("SmsNewMsgBatchPool", sizeof(SmsNewMsgBatch_t));
 
-    LE_INFO("Received message from '%s', to '%s' (len=%u, readSz=%zd)",
-        rxBuffer.header.origAddress,
-        rxBuffer.header.destAddress,
-        rxBuffer.header.dataLen,
-        readSz);
+    simuConfig_RegisterService(&ConfigService);
 
-    if(!mrc_simu_IsOnline())
-    {
-        LE_WARN("Not handling message because we're offline.");
-        return;
-    }
+    // Allocate the storage with the configured capacity, or load it from the configured files
+    InitSmsBank(GetSmsBank(PA_SMS_STORAGE_NV));
+    InitSmsBank(GetSmsBank(PA_SMS_STORAGE_SIM));
 
-    /* Not handling multiple message per read */
-    LE_FATAL_IF( (sizeof(pa_sms_SimuPdu_t) + rxBuffer.header.dataLen) != readSz, "Problem on reception (size=%zd)", readSz);
+    // The transport settings have been read from the configuration tree
+    LE_FATAL_IF(LE_OK != InitSmsServer(), "Unable to start the SMS server");
+    SmsServerStarted = true;
 
-    SmsServerHandleRemoteMessage( &(rxBuffer.header) );
+    return LE_OK;
 }
 
+
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle an incoming socket connection.
+ * Grow an array of the cell broadcast configuration so that it can hold one more entry.
+ *
+ * @return LE_NO_MEMORY    The array could not be grown.
+ * @return LE_OK           The function succeeded.
  */
 //--------------------------------------------------------------------------------------------------
-static void SmsServerConn
+static le_result_t GrowCellBroadcastArray
 (
-    int listenFd
+    void** arrayPtrPtr,     ///< [IN/OUT] Array
+    uint32_t* capacityPtr,  ///< [IN/OUT] Number of entries of the array
+    uint32_t count,         ///< [IN] Number of entries in use
+    size_t entrySize        ///< [IN] Size of an entry
 )
 {
-    int connFd;
-    struct sockaddr inAddr;
-    socklen_t inLen = sizeof(struct sockaddr);
-    int fdIndex = -1;
-    char monitorFdName[100];
-
-    LE_INFO("Conn listenFd=%d", listenFd);
+    uint32_t newCapacity;
+    void* newArrayPtr;
 
-    /* Look for a free connection */
-    for(fdIndex = 0; fdIndex < PA_SMS_SIMU_MAX_CONN; fdIndex++)
+    if (count < *capacityPtr)
     {
-        if(SmsServerConnections[fdIndex].used == false)
-        {
-            break;
-        }
+        return LE_OK;
     }
 
-    if(fdIndex == PA_SMS_SIMU_MAX_CONN)
+    newCapacity = (0 == *capacityPtr) ? PA_SIMU_SMS_DEFAULT_CB_CONFIG_MAX : (*capacityPtr * 2);
+    newArrayPtr = realloc(*arrayPtrPtr, newCapacity * entrySize);
+    if (NULL == newArrayPtr)
     {
-        LE_WARN("Nb of allowed connections reached (%d)", PA_SMS_SIMU_MAX_CONN);
-        return;
+        return LE_NO_MEMORY;
     }
 
-    connFd = accept(listenFd, &inAddr, &inLen);
-    LE_FATAL_IF( (connFd < 0), "Unable to accept connection" );
+    *arrayPtrPtr = newArrayPtr;
+    *capacityPtr = newCapacity;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a 3GPP range in the configuration.
+ *
+ * @return true if the range is configured, false otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool FindCellBroadcastRange
+(
+    uint16_t fromId,        ///< [IN] Starting point of the range
+    uint16_t toId,          ///< [IN] Ending point of the range
+    uint32_t* posPtr        ///< [OUT] Position of the range, or where to insert it
+)
+{
+    uint32_t low = 0;
+    uint32_t high = CellBroadcastConfig.rangeCnt;
 
-    LE_INFO("Accept Connection idx=%d fd=%d", fdIndex, connFd);
+    while (low < high)
+    {
+        uint32_t mid = low + ((high - low) / 2);
+        const CellBroadcastRange_t* rangePtr = &CellBroadcastConfig.rangesPtr[mid];
 
-    snprintf(monitorFdName, sizeof(monitorFdName), "SmsSimuConn[%u]", fdIndex);
+        if ((rangePtr->fromId < fromId) ||
+            ((rangePtr->fromId == fromId) && (rangePtr->toId < toId)))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
 
-    SmsServerConnections[fdIndex].used = true;
-    SmsServerConnections[fdIndex].fd = connFd;
-    SmsServerConnections[fdIndex].fdMonitorRef = le_fdMonitor_Create(monitorFdName,
-                                                                     connFd,
-                                                                     SmsServerRead,
-                                                                     POLLIN);
+    *posPtr = low;
+    return (low < CellBroadcastConfig.rangeCnt) &&
+           (CellBroadcastConfig.rangesPtr[low].fromId == fromId) &&
+           (CellBroadcastConfig.rangesPtr[low].toId == toId);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle an error on the socket connection.
+ * Rebuild the union of the 3GPP ranges, merging the overlapping and adjacent ones.
  */
 //--------------------------------------------------------------------------------------------------
-static void SmsServerError
+static void MergeCellBroadcastRanges
 (
     void
 )
 {
-    LE_FATAL("SMS Server Error");
+    CellBroadcastRange_t* mergedPtr = CellBroadcastConfig.mergedRangesPtr;
+    uint32_t mergedCnt = 0;
+    uint32_t i;
+
+    for (i = 0; i < CellBroadcastConfig.rangeCnt; i++)
+    {
+        const CellBroadcastRange_t* rangePtr = &CellBroadcastConfig.rangesPtr[i];
+
+        if ((mergedCnt > 0) && (rangePtr->fromId <= (mergedPtr[mergedCnt - 1].toId + 1U)))
+        {
+            if (rangePtr->toId > mergedPtr[mergedCnt - 1].toId)
+            {
+                mergedPtr[mergedCnt - 1].toId = rangePtr->toId;
+            }
+        }
+        else
+        {
+            mergedPtr[mergedCnt++] = *rangePtr;
+        }
+    }
+
+    CellBroadcastConfig.mergedRangeCnt = mergedCnt;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Event handler for file descriptor events for the SMS server listen socket.
- **/
+ * Check whether a 3GPP message identifier is in the configured ranges.
+ *
+ * @return true if the identifier is selected, false otherwise.
+ */
 //--------------------------------------------------------------------------------------------------
-static void SmsServerListenEvent
+static bool IsCellBroadcastIdSelected
 (
-    int fd,         ///< Socket file descriptor.
-    short events    ///< Bit map of events.  Expect POLLIN (readable) and POLLERR (error).
+    uint32_t messageId      ///< [IN] Message identifier
 )
-//--------------------------------------------------------------------------------------------------
 {
-    if (events & POLLERR)
-    {
-        SmsServerError();
-    }
+    const CellBroadcastRange_t* mergedPtr = CellBroadcastConfig.mergedRangesPtr;
+    uint32_t low = 0;
+    uint32_t high = CellBroadcastConfig.mergedRangeCnt;
 
-    if (events & POLLIN)
+    // Find the first range starting after the identifier
+    while (low < high)
     {
-        SmsServerConn(fd);
+        uint32_t mid = low + ((high - low) / 2);
+
+        if (mergedPtr[mid].fromId <= messageId)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
+
+    return (low > 0) && (messageId <= mergedPtr[low - 1].toId);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Initialize SMS server
+ * Find a 3GPP2 service in the configuration.
+ *
+ * @return true if the service is configured, false otherwise.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t InitSmsServer
+static bool FindCdmaCellBroadcastService
 (
-    uint16_t port   ///< [IN] TCP Port on which the server is provided
+    uint32_t serviceCat,    ///< [IN] Service category
+    uint32_t language,      ///< [IN] Language
+    uint32_t* posPtr        ///< [OUT] Position of the service, or where to insert it
 )
 {
-    struct sockaddr_in sockAddr;
-    int res;
-
-    SmsServerListenFd = socket(AF_INET, SOCK_STREAM, 0);
-    LE_FATAL_IF( (SmsServerListenFd < 0), "Error when creating socket ..." );
+    uint32_t key = (serviceCat << 16) | (language & 0xFFFF);
+    uint32_t low = 0;
+    uint32_t high = CellBroadcastConfig.serviceCnt;
 
-    bzero(&sockAddr, sizeof(sockAddr));
-    sockAddr.sin_family = AF_INET;
-    sockAddr.sin_port = htons(port);
-    sockAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    res = bind(SmsServerListenFd, (struct sockaddr *)&sockAddr, sizeof(sockAddr));
-    LE_FATAL_IF( (res < 0), "Error when binding socket ..." );
-
-    LE_INFO("SMS Server on port %u (listenFd=%d)", port, SmsServerListenFd);
+    while (low < high)
+    {
+        uint32_t mid = low + ((high - low) / 2);
 
-    res = listen(SmsServerListenFd, 1024);
-    LE_FATAL_IF( (res < 0), "Error when starting to listen on socket ..." );
+        if (CellBroadcastConfig.servicesPtr[mid] < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
 
-    SmsServerMonitorRef = le_fdMonitor_Create("SmsSimuFd",
-                                              SmsServerListenFd,
-                                              SmsServerListenEvent,
-                                              POLLIN);
-    return LE_OK;
+    *posPtr = low;
+    return (low < CellBroadcastConfig.serviceCnt) && (CellBroadcastConfig.servicesPtr[low] == key);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * SMS Stub initialization.
+ * Handle a cell broadcast PDU injected on a socket connection.
  *
+ * The PDU is reported to the new message handler, without being stored, if cell broadcast is
+ * activated for its protocol and the configuration selects its identifier.
+ *
+ * @return LE_FORMAT_ERROR The frame is not valid.
+ * @return LE_NOT_POSSIBLE The modem is offline, or cell broadcast is not activated.
+ * @return LE_NOT_FOUND    The PDU is filtered out by the configuration.
  * @return LE_OK           The function succeeded.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t sms_simu_Init
+static le_result_t SmsServerHandleCellBroadcast
 (
-    void
+    const pa_sms_SimuPdu_t* framePtr    ///< [IN] PA_SIMU_SMS_FRAME_CELL_BROADCAST frame
 )
 {
-    LE_INFO("PA SMS Init");
+    const pa_sms_SimuCbHeader_t* cbPtr = (const pa_sms_SimuCbHeader_t*)framePtr->data;
+    pa_sms_NewMessageIndication_t msgIndication;
+    uint32_t pduLen;
+    uint32_t pos;
 
-    LE_FATAL_IF(LE_OK != smsPdu_Initialize(), "Unable to init smsPdu");
+    if ((framePtr->dataLen < sizeof(pa_sms_SimuCbHeader_t)) ||
+        ((framePtr->dataLen - sizeof(pa_sms_SimuCbHeader_t)) > sizeof(msgIndication.pduCB)))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    pduLen = framePtr->dataLen - sizeof(pa_sms_SimuCbHeader_t);
 
-    EventNewSmsId = le_event_CreateId("EventNewSmsId", sizeof(pa_sms_NewMessageIndication_t));
+    if (!mrc_simu_IsOnline())
+    {
+        return LE_NOT_POSSIBLE;
+    }
+
+    switch (cbPtr->protocol)
+    {
+        case PA_SMS_PROTOCOL_GW_CB:
+            if (!CellBroadcastConfig.isGwActivated)
+            {
+                return LE_NOT_POSSIBLE;
+            }
+            if (!IsCellBroadcastIdSelected(cbPtr->id))
+            {
+                LE_DEBUG("Cell broadcast message id %u filtered out", cbPtr->id);
+                return LE_NOT_FOUND;
+            }
+            break;
+
+        case PA_SMS_PROTOCOL_CDMA:
+            if (!CellBroadcastConfig.isCdmaActivated)
+            {
+                return LE_NOT_POSSIBLE;
+            }
+            if ((cbPtr->id > UINT16_MAX) ||
+                !FindCdmaCellBroadcastService(cbPtr->id, cbPtr->language, &pos))
+            {
+                LE_DEBUG("Cell broadcast service %u language %u filtered out",
+                         cbPtr->id, cbPtr->language);
+                return LE_NOT_FOUND;
+            }
+            break;
 
-    pa_sms_DelAllMsg();
+        default:
+            return LE_FORMAT_ERROR;
+    }
 
-    SmsMemPoolRef = le_mem_CreatePool("SmsMemPoolRef", sizeof(SmsMsgRef));
-    le_mem_SetDestructor(SmsMemPoolRef, SmsMemPoolDestructor);
+    memset(&msgIndication, 0, sizeof(msgIndication));
+    msgIndication.protocol = cbPtr->protocol;
+    msgIndication.storage = PA_SMS_STORAGE_NONE;
+    msgIndication.pduLen = pduLen;
+    memcpy(msgIndication.pduCB, framePtr->data + sizeof(pa_sms_SimuCbHeader_t), pduLen);
 
-    InitSmsServer(5000);
+    le_event_Report(EventNewSmsId, &msgIndication, sizeof(msgIndication));
 
     return LE_OK;
 }
 
-
 //--------------------------------------------------------------------------------------------------
 /**
  * Activate Cell Broadcast message notification
@@ -1124,6 +5266,14 @@ le_result_t pa_sms_ActivateCellBroadcast
     pa_sms_Protocol_t protocol
 )
 {
+    if (PA_SMS_PROTOCOL_GW_CB == protocol)
+    {
+        CellBroadcastConfig.isGwActivated = true;
+    }
+    else if (PA_SMS_PROTOCOL_CDMA == protocol)
+    {
+        CellBroadcastConfig.isCdmaActivated = true;
+    }
     return LE_OK;
 }
 
@@ -1140,6 +5290,14 @@ le_result_t pa_sms_DeactivateCellBroadcast
     pa_sms_Protocol_t protocol
 )
 {
+    if (PA_SMS_PROTOCOL_GW_CB == protocol)
+    {
+        CellBroadcastConfig.isGwActivated = false;
+    }
+    else if (PA_SMS_PROTOCOL_CDMA == protocol)
+    {
+        CellBroadcastConfig.isCdmaActivated = false;
+    }
     return LE_OK;
 }
 
@@ -1164,29 +5322,50 @@ le_result_t pa_sms_AddCellBroadcastIds
         ///< Ending point of the range of cell broadcast message identifier.
 )
 {
-    int i;
+    uint32_t pos;
+
+    if (fromId > toId)
+    {
+        LE_ERROR("Invalid range [%u, %u]", fromId, toId);
+        return LE_FAULT;
+    }
 
-    if (CellBroadcastConfig.nbCell3GPPConfig >= PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX)
+    if (CellBroadcastConfig.rangeCnt >= CellBroadcastConfigMax)
     {
         LE_ERROR("Max Cell Broadcast service number reached!!");
         return LE_FAULT;
     }
 
-    for(i=0; (i < CellBroadcastConfig.nbCell3GPPConfig)
-    && (i < PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX); i++)
+    if (FindCellBroadcastRange(fromId, toId, &pos))
     {
-        if ( (CellBroadcastConfig.Cell3GPPBroadcast[i].fromId == fromId)
-                        && (CellBroadcastConfig.Cell3GPPBroadcast[i].toId == toId))
+        LE_DEBUG("Parameter already set");
+        return LE_FAULT;
+    }
+
+    if (CellBroadcastConfig.rangeCnt >= CellBroadcastConfig.rangeCapacity)
+    {
+        uint32_t capacity = CellBroadcastConfig.rangeCapacity;
+
+        if ((LE_OK != GrowCellBroadcastArray((void**)&CellBroadcastConfig.rangesPtr, &capacity,
+                                             CellBroadcastConfig.rangeCnt,
+                                             sizeof(CellBroadcastRange_t))) ||
+            (LE_OK != GrowCellBroadcastArray((void**)&CellBroadcastConfig.mergedRangesPtr,
+                                             &CellBroadcastConfig.rangeCapacity,
+                                             CellBroadcastConfig.rangeCnt,
+                                             sizeof(CellBroadcastRange_t))))
         {
-            LE_DEBUG("Parameter already set");
+            LE_ERROR("Unable to grow the Cell Broadcast configuration");
             return LE_FAULT;
         }
     }
 
-    CellBroadcastConfig.Cell3GPPBroadcast[CellBroadcastConfig.nbCell3GPP2Config].fromId = fromId;
-    CellBroadcastConfig.Cell3GPPBroadcast[CellBroadcastConfig.nbCell3GPP2Config].toId = toId;
-    CellBroadcastConfig.Cell3GPPBroadcast[CellBroadcastConfig.nbCell3GPP2Config].selected = 1;
-    CellBroadcastConfig.nbCell3GPPConfig++;
+    memmove(&CellBroadcastConfig.rangesPtr[pos + 1], &CellBroadcastConfig.rangesPtr[pos],
+            (CellBroadcastConfig.rangeCnt - pos) * sizeof(CellBroadcastRange_t));
+    CellBroadcastConfig.rangesPtr[pos].fromId = fromId;
+    CellBroadcastConfig.rangesPtr[pos].toId = toId;
+    CellBroadcastConfig.rangeCnt++;
+
+    MergeCellBroadcastRanges();
 
     return  LE_OK;
 }
@@ -1211,42 +5390,21 @@ le_result_t pa_sms_RemoveCellBroadcastIds
         ///< Ending point of the range of cell broadcast message identifier.
 )
 {
-    int i,j;
+    uint32_t pos;
 
-    for(i=0; (i < CellBroadcastConfig.nbCell3GPPConfig)
-          && (i < PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX); i++)
+    if (!FindCellBroadcastRange(fromId, toId, &pos))
     {
-        if ( (CellBroadcastConfig.Cell3GPPBroadcast[i].fromId == fromId)
-              && (CellBroadcastConfig.Cell3GPPBroadcast[i].toId == toId))
-        {
-            CellBroadcastConfig.Cell3GPPBroadcast[i].selected = 0;
+        LE_ERROR("Entry not Found!");
+        return LE_FAULT;
+    }
 
-            // Not applicable if it is the only or the last entry in the array
-            if(i < (CellBroadcastConfig.nbCell3GPPConfig - 1))
-            {
-                for(j = i+1 ; (j < (CellBroadcastConfig.nbCell3GPPConfig -1))
-                           && (j < PA_SMS_SIMU_3GPP_BROADCAST_CONFIG_MAX); j++ )
-                {
-                    CellBroadcastConfig.Cell3GPPBroadcast[j-1].fromId =
-                                    CellBroadcastConfig.Cell3GPPBroadcast[j].fromId;
-                    CellBroadcastConfig.Cell3GPPBroadcast[j-1].toId =
-                                    CellBroadcastConfig.Cell3GPPBroadcast[j].toId;
-                    CellBroadcastConfig.Cell3GPPBroadcast[j-1].selected =
-                                    CellBroadcastConfig.Cell3GPPBroadcast[j].selected;
-                }
-            }
-            memset(&CellBroadcastConfig.Cell3GPPBroadcast[CellBroadcastConfig.nbCell3GPPConfig-1], 0,
-                sizeof(BoardcastConfigInfo3gpp_t));
-            CellBroadcastConfig.nbCell3GPPConfig--;
+    CellBroadcastConfig.rangeCnt--;
+    memmove(&CellBroadcastConfig.rangesPtr[pos], &CellBroadcastConfig.rangesPtr[pos + 1],
+            (CellBroadcastConfig.rangeCnt - pos) * sizeof(CellBroadcastRange_t));
 
-            return LE_OK;
-        }
-        else
-        {
-            LE_ERROR("Entry not Found!");
-        }
-    }
-    return LE_FAULT;
+    MergeCellBroadcastRanges();
+
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1262,9 +5420,8 @@ le_result_t pa_sms_ClearCellBroadcastIds
     void
 )
 {
-    memset(&CellBroadcastConfig.Cell3GPPBroadcast[0], 0,
-             sizeof(CellBroadcastConfig.Cell3GPPBroadcast));
-    CellBroadcastConfig.nbCell3GPPConfig = 0;
+    CellBroadcastConfig.rangeCnt = 0;
+    CellBroadcastConfig.mergedRangeCnt = 0;
     return LE_OK;
 }
 
@@ -1291,29 +5448,32 @@ le_result_t pa_sms_AddCdmaCellBroadcastServices
         ///< Value Assignments
 )
 {
-    int i;
+    uint32_t pos;
 
-    if (CellBroadcastConfig.nbCell3GPP2Config >= PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX)
+    if (CellBroadcastConfig.serviceCnt >= CellBroadcastConfigMax)
     {
         LE_ERROR("Max CDMA Cell Broadcast service number reached!!");
         return LE_FAULT;
     }
 
-    for(i=0; (i < CellBroadcastConfig.nbCell3GPP2Config)
-        && (i < PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX); i++)
+    if (FindCdmaCellBroadcastService(serviceCat, language, &pos))
     {
-        if ( (CellBroadcastConfig.Cell3GPP2Broadcast[i].serviceCategory == serviceCat)
-          && (CellBroadcastConfig.Cell3GPP2Broadcast[i].language == language) )
-        {
-            LE_ERROR("Cell Broadcast service number already set");
-            return LE_FAULT;
-        }
+        LE_ERROR("Cell Broadcast service number already set");
+        return LE_FAULT;
     }
 
-    CellBroadcastConfig.Cell3GPP2Broadcast[CellBroadcastConfig.nbCell3GPP2Config].serviceCategory = serviceCat;
-    CellBroadcastConfig.Cell3GPP2Broadcast[CellBroadcastConfig.nbCell3GPP2Config].language = language;
-    CellBroadcastConfig.Cell3GPP2Broadcast[CellBroadcastConfig.nbCell3GPP2Config].selected = 1;
-    CellBroadcastConfig.nbCell3GPP2Config++;
+    if (LE_OK != GrowCellBroadcastArray((void**)&CellBroadcastConfig.servicesPtr,
+                                        &CellBroadcastConfig.serviceCapacity,
+                                        CellBroadcastConfig.serviceCnt, sizeof(uint32_t)))
+    {
+        LE_ERROR("Unable to grow the CDMA Cell Broadcast configuration");
+        return LE_FAULT;
+    }
+
+    memmove(&CellBroadcastConfig.servicesPtr[pos + 1], &CellBroadcastConfig.servicesPtr[pos],
+            (CellBroadcastConfig.serviceCnt - pos) * sizeof(uint32_t));
+    CellBroadcastConfig.servicesPtr[pos] = ((uint32_t)serviceCat << 16) | (language & 0xFFFF);
+    CellBroadcastConfig.serviceCnt++;
 
     return LE_OK;
 }
@@ -1341,38 +5501,18 @@ le_result_t pa_sms_RemoveCdmaCellBroadcastServices
         ///< Value Assignments
 )
 {
-    int i,j;
+    uint32_t pos;
 
-    for(i=0; (i < CellBroadcastConfig.nbCell3GPP2Config)
-          && (i < PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX); i++)
+    if (!FindCdmaCellBroadcastService(serviceCat, language, &pos))
     {
-        if ( (CellBroadcastConfig.Cell3GPP2Broadcast[i].serviceCategory == serviceCat)
-          && (CellBroadcastConfig.Cell3GPP2Broadcast[i].language == language) )
-        {
-            CellBroadcastConfig.Cell3GPP2Broadcast[i].selected = 0;
+        return LE_FAULT;
+    }
 
-            // Not applicable if it is the only or the last entry in the array
-            if(i < (CellBroadcastConfig.nbCell3GPP2Config - 1))
-            {
-                for(j = i+1 ; (j < CellBroadcastConfig.nbCell3GPP2Config)
-                           && (j < PA_SMS_SIMU_3GPP2_BROADCAST_CONFIG_MAX); j++ )
-                {
-                    CellBroadcastConfig.Cell3GPP2Broadcast[j-1].serviceCategory =
-                                    CellBroadcastConfig.Cell3GPP2Broadcast[j].serviceCategory;
-                    CellBroadcastConfig.Cell3GPP2Broadcast[j-1].language =
-                                    CellBroadcastConfig.Cell3GPP2Broadcast[j].language;
-                    CellBroadcastConfig.Cell3GPP2Broadcast[j-1].selected =
-                                    CellBroadcastConfig.Cell3GPP2Broadcast[j].selected;
-                }
-            }
-            memset(&CellBroadcastConfig.Cell3GPP2Broadcast[CellBroadcastConfig.nbCell3GPP2Config-1],
-                0, sizeof(BoardcastConfigInfo3gpp2_t));
+    CellBroadcastConfig.serviceCnt--;
+    memmove(&CellBroadcastConfig.servicesPtr[pos], &CellBroadcastConfig.servicesPtr[pos + 1],
+            (CellBroadcastConfig.serviceCnt - pos) * sizeof(uint32_t));
 
-            CellBroadcastConfig.nbCell3GPP2Config--;
-            return LE_OK;
-        }
-    }
-    return LE_FAULT;
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1388,9 +5528,6 @@ le_result_t pa_sms_ClearCdmaCellBroadcastServices
     void
 )
 {
-    memset(&CellBroadcastConfig.Cell3GPP2Broadcast[0], 0,
-        sizeof(CellBroadcastConfig.Cell3GPP2Broadcast));
-    CellBroadcastConfig.nbCell3GPP2Config = 0;
+    CellBroadcastConfig.serviceCnt = 0;
     return LE_OK;
 }
-
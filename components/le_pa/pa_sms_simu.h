@@ -12,6 +12,14 @@
 #include "pa_sms_simu.h"
 #include "pa_mrc_simu.h"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Frame exchanged with the clients of the SMS server.
+ *
+ * The TCP stream is a sequence of frames, each made of this fixed-size header followed by
+ * 'dataLen' bytes of data. Frames can be sent back-to-back and split over several reads.
+ */
+//--------------------------------------------------------------------------------------------------
 typedef struct __attribute__((__packed__)) {
     uint8_t origAddress[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
     uint8_t destAddress[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
@@ -21,6 +29,165 @@ typedef struct __attribute__((__packed__)) {
 }
 pa_sms_SimuPdu_t;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Frame types.
+ *
+ * The 'protocol' field of a frame header either holds the pa_sms_Protocol_t of the PDU carried
+ * in the data, or one of the following values for the frames that are not a single PDU.
+ *
+ * - PA_SIMU_SMS_FRAME_BATCH: sent by a client, the data is a sequence of up to
+ *   PA_SIMU_SMS_MAX_BATCH_CNT PDU frames (header + data each) to store as incoming messages.
+ * - PA_SIMU_SMS_FRAME_BATCH_ACK: sent by the server in reply to a batch, the data is an array of
+ *   pa_sms_SimuBatchResult_t, one per PDU of the batch, in the same order.
+ * - PA_SIMU_SMS_FRAME_DELIVERY_REPORTS: sent by a client without data, to receive a
+ *   PA_SIMU_SMS_FRAME_DELIVERED frame for each PDU or batch frame it sends from then on.
+ * - PA_SIMU_SMS_FRAME_DELIVERED: sent by the server once the new message handler has been called
+ *   for the PDUs of a frame, the data is an array of pa_sms_SimuBatchResult_t as for a batch
+ *   acknowledgement. These frames are sent in the order of the PDU and batch frames, so that a
+ *   client can measure the end-to-end latency of the reception path.
+ * - PA_SIMU_SMS_FRAME_CELL_BROADCAST: sent by a client, the data is a pa_sms_SimuCbHeader_t
+ *   followed by a cell broadcast PDU, delivered if it matches the cell broadcast configuration.
+ * - PA_SIMU_SMS_FRAME_CONCAT: sent by a client, the data is a pa_sms_SimuConcatHeader_t followed by
+ *   a payload, delivered from 'origAddress' as concatenated GSM SMS-DELIVER segments. Sent by the
+ *   server to the clients asking for it, with the user data of the SMS-SUBMIT segments of a
+ *   concatenated message once all of them have been sent by the Legato world.
+ * - PA_SIMU_SMS_FRAME_CONCAT_REASSEMBLY: sent by a client without data, to receive a
+ *   PA_SIMU_SMS_FRAME_CONCAT frame for each concatenated message sent from then on, instead of
+ *   its segments.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_SIMU_SMS_FRAME_BATCH             0x100
+#define PA_SIMU_SMS_FRAME_BATCH_ACK         0x101
+#define PA_SIMU_SMS_FRAME_DELIVERY_REPORTS  0x102
+#define PA_SIMU_SMS_FRAME_DELIVERED         0x103
+#define PA_SIMU_SMS_FRAME_CELL_BROADCAST    0x104
+#define PA_SIMU_SMS_FRAME_CONCAT            0x105
+#define PA_SIMU_SMS_FRAME_CONCAT_REASSEMBLY 0x106
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Result of the storage of one PDU of a batch.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((__packed__)) {
+    int32_t result;         ///< LE_OK if stored, LE_NO_MEMORY if the storage is full, ...
+    uint32_t storage;       ///< pa_sms_Storage_t where the PDU is stored
+    uint32_t index;         ///< Index of the PDU in the storage
+}
+pa_sms_SimuBatchResult_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header of an injected cell broadcast PDU, holding the fields it is filtered on.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((__packed__)) {
+    uint32_t protocol;      ///< PA_SMS_PROTOCOL_GW_CB or PA_SMS_PROTOCOL_CDMA
+    uint32_t id;            ///< Message identifier (3GPP) or service category (3GPP2)
+    uint32_t language;      ///< le_sms_Languages_t, 3GPP2 only
+}
+pa_sms_SimuCbHeader_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header of a concatenated message payload.
+ *
+ * The injection settings are only used in the frames sent by the clients, 'segmentCnt' and
+ * 'reassemblyUs' only in the frames sent by the server.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((__packed__)) {
+    uint32_t encoding;          ///< PA_SIMU_SMS_CONCAT_7_BITS, _8_BITS or _UCS2
+    uint32_t reference;         ///< Reference of the message, 0 to let the server choose one
+    uint32_t segmentCnt;        ///< Number of segments
+    uint32_t segmentDelayMs;    ///< Injection: delay between two segments
+    uint32_t flags;             ///< Injection: PA_SIMU_SMS_CONCAT_REORDER
+    uint32_t lossPercent;       ///< Injection: probability to drop each segment, in percent
+    uint32_t dropMask;          ///< Injection: segments always dropped, bit 0 for the first one
+    uint32_t reassemblyUs;      ///< Time between the first and the last segment, in microseconds
+}
+pa_sms_SimuConcatHeader_t;
+
+// Encodings of a concatenated message payload. A 7-bit payload is made of unpacked septets of the
+// GSM default alphabet.
+#define PA_SIMU_SMS_CONCAT_7_BITS       0
+#define PA_SIMU_SMS_CONCAT_8_BITS       1
+#define PA_SIMU_SMS_CONCAT_UCS2         2
+
+// Injection flag: the segments are delivered in a random order
+#define PA_SIMU_SMS_CONCAT_REORDER      0x01
+
+// Maximum number of segments of a concatenated message
+#define PA_SIMU_SMS_MAX_CONCAT_CNT      64
+
+// Maximum length of the user data of a segment, in septets or octets
+#define PA_SIMU_SMS_MAX_CONCAT_SEGMENT_LEN  160
+
+// Maximum length of the data of a concatenated message frame
+#define PA_SIMU_SMS_MAX_CONCAT_DATA_LEN \
+    (sizeof(pa_sms_SimuConcatHeader_t) + \
+     (PA_SIMU_SMS_MAX_CONCAT_CNT * PA_SIMU_SMS_MAX_CONCAT_SEGMENT_LEN))
+
+// Reassembly of the concatenated messages sent by the Legato world
+#define PA_SIMU_SMS_DEFAULT_CONCAT_TIMEOUT_MS   60000
+#define PA_SIMU_SMS_MAX_CONCAT_PENDING          16
+
+// Maximum number of PDUs in a batch
+#define PA_SIMU_SMS_MAX_BATCH_CNT       64
+
+// Maximum length of the data of a PDU frame
+#define PA_SIMU_SMS_MAX_PDU_DATA_LEN    LE_SMS_PDU_MAX_BYTES
+
+// Maximum length of the data of a batch frame
+#define PA_SIMU_SMS_MAX_BATCH_DATA_LEN  \
+    (PA_SIMU_SMS_MAX_BATCH_CNT * (sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN))
+
+// Maximum length of the data of a cell broadcast frame
+#define PA_SIMU_SMS_MAX_CB_DATA_LEN     (sizeof(pa_sms_SimuCbHeader_t) + LE_SMS_PDU_MAX_BYTES)
+
+// Number of 3GPP message identifier ranges, and of 3GPP2 services, of the cell broadcast
+// configuration
+#define PA_SIMU_SMS_DEFAULT_CB_CONFIG_MAX   50
+#define PA_SIMU_SMS_MAX_CB_CONFIG_MAX       65536
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * File backing a storage bank (SIM or NV).
+ *
+ * The file is memory-mapped by the platform adaptor: it is made of this header followed by
+ * 'capacity' slots. A slot holds a message if its generation is the generation of the header and
+ * its status is not LE_SMS_STATUS_UNKNOWN, so deleting all the messages only requires to change
+ * the generation of the header. A file can be generated beforehand to provision a storage.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((__packed__)) {
+    uint32_t magic;         ///< PA_SIMU_SMS_BANK_FILE_MAGIC
+    uint32_t version;       ///< PA_SIMU_SMS_BANK_FILE_VERSION
+    uint32_t capacity;      ///< Number of slots
+    uint32_t slotSize;      ///< sizeof(pa_sms_SimuBankFileSlot_t)
+    uint32_t generation;    ///< Current generation of the bank
+    uint32_t reserved[3];
+}
+pa_sms_SimuBankFileHeader_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Slot of a storage bank file.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((__packed__)) {
+    uint32_t generation;    ///< Generation of the bank when the message was stored
+    uint32_t status;        ///< le_sms_Status_t, LE_SMS_STATUS_UNKNOWN if free
+    uint32_t protocol;      ///< pa_sms_Protocol_t
+    uint32_t dataLen;       ///< Length of the PDU
+    uint8_t data[LE_SMS_PDU_MAX_BYTES];
+}
+pa_sms_SimuBankFileSlot_t;
+
+#define PA_SIMU_SMS_BANK_FILE_MAGIC     0x42534d53  // "SMSB"
+#define PA_SIMU_SMS_BANK_FILE_VERSION   1
+
 // simulate storage type values
 #define SIMU_SMS_STORAGE_SIM    0
 #define SIMU_SMS_STORAGE_NV     1
@@ -28,6 +195,81 @@ pa_sms_SimuPdu_t;
 
 #define PA_SIMU_SMS_DEFAULT_SMSC    ""
 
+// Number of messages in the SIM and NV storages
+#define PA_SIMU_SMS_DEFAULT_STORAGE_CAPACITY    16
+#define PA_SIMU_SMS_MAX_STORAGE_CAPACITY        10000
+
+// Maximum number of indexes returned by pa_sms_ListMsgFromMem(), i.e. the size of the index array
+// provided by the modem daemon. Only the first indexes of a larger list are returned, with
+// LE_OVERFLOW.
+#define PA_SIMU_SMS_MAX_LIST_CNT                256
+
+// Default TCP port of the SMS server
+#define PA_SIMU_SMS_DEFAULT_PORT        5000
+
+// SMS server connections
+#define PA_SIMU_SMS_DEFAULT_MAX_CONN    8
+#define PA_SIMU_SMS_MAX_CONN_LIMIT      256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the receive path copies.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint64_t rxMsgCnt;          ///< Number of messages stored
+    uint64_t rxCopiedBytes;     ///< Bytes copied between the socket and the storage
+    uint64_t readMsgCnt;        ///< Number of messages read from the storage
+    uint64_t readCopiedBytes;   ///< Bytes copied when reading messages from the storage
+    uint64_t listPartialCnt;    ///< Listings limited to PA_SIMU_SMS_MAX_LIST_CNT indexes
+}
+pa_smsSimu_CopyStats_t;
+
+// Maximum number of frames waiting to be sent on one SMS server connection
+#define PA_SIMU_SMS_DEFAULT_TX_QUEUE_MAX    256
+#define PA_SIMU_SMS_MAX_TX_QUEUE_MAX        65536
+
+// Maximum simulated delay between the submission of a message and its delivery, in milliseconds
+#define PA_SIMU_SMS_MAX_DELIVERY_DELAY_MS   3600000
+
+// Status reports: maximum number of outcomes, and TP-ST of the reports by default (delivered)
+#define PA_SIMU_SMS_MAX_SR_OUTCOMES         8
+#define PA_SIMU_SMS_DEFAULT_SR_STATUS       0x00
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the outbound pipeline.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint64_t submittedCnt;      ///< Number of messages submitted by pa_sms_SendPduMsg()
+    uint64_t deliveredCnt;      ///< Number of messages delivered after the simulated latency
+    uint64_t queuedCnt;         ///< Number of frames queued to the connections
+    uint64_t sentCnt;           ///< Number of frames completely written to the connections
+    uint64_t droppedCnt;        ///< Number of frames dropped because a connection queue was full
+    uint64_t failedCnt;         ///< Number of frames dropped because of a connection error
+    uint64_t statusReportCnt;   ///< Number of status reports scheduled
+    uint64_t statusReportDeliveredCnt;  ///< Number of status reports stored
+}
+pa_smsSimu_TxStats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the concatenated messages.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint64_t injectedMsgCnt;        ///< Number of concatenated messages injected by the clients
+    uint64_t injectedSegmentCnt;    ///< Number of injected segments delivered
+    uint64_t droppedSegmentCnt;     ///< Number of injected segments dropped by the simulated loss
+    uint64_t segmentCnt;            ///< Number of segments sent by the Legato world
+    uint64_t reassembledMsgCnt;     ///< Number of messages whose segments have all been sent
+    uint64_t expiredMsgCnt;         ///< Number of messages given up before all their segments
+    uint64_t reassemblyTotalUs;     ///< Sum of the reassembly times of the messages
+    uint64_t reassemblyMaxUs;       ///< Longest reassembly time
+}
+pa_smsSimu_ConcatStats_t;
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Set the type of storage in case of full storage indication
@@ -63,6 +305,47 @@ void pa_sms_SetSmsErrCause
    int errorCode
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the counters of the receive path copies.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_smsSimu_GetCopyStats
+(
+    pa_smsSimu_CopyStats_t* statsPtr    ///< [OUT] Counters
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the counters of the outbound pipeline.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_smsSimu_GetTxStats
+(
+    pa_smsSimu_TxStats_t* statsPtr      ///< [OUT] Counters
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the counters of the concatenated messages.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_smsSimu_GetConcatStats
+(
+    pa_smsSimu_ConcatStats_t* statsPtr  ///< [OUT] Counters
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalidate the cached subscriber phone number. Called by the SIM module when the phone number or
+ * the SIM state changes.
+ */
+//--------------------------------------------------------------------------------------------------
+void sms_simu_InvalidateLocalNumber
+(
+    void
+);
+
 le_result_t sms_simu_Init
 (
     void
@@ -5,7 +5,9 @@
  *
  * The current implementation is quite limited, but simulates a filesystem that has a limite size
  * and can store, retreive and delete entries.
- * It is stored in RAM and therefore volatile.
+ * Entries are kept in RAM, and persisted in an append-only journal: each write, delete or move
+ * appends one record to the journal, which is compacted once it holds more stale records than
+ * live ones.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -24,9 +26,111 @@
 # define SECSTORE_RECORD_PATH "/legato/systems/current/config/secStore.raw"
 #endif
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum amount of stale records, in bytes, before the journal is compacted.
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef SECSTORE_COMPACT_MIN_BYTES
+# define SECSTORE_COMPACT_MIN_BYTES (64 * 1024)
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Journal identification, at the beginning of the file.
+ *
+ * Files without this header are in the legacy format: a plain sequence of fixed-size entries. They
+ * are only read, to be converted to a journal.
+ */
+//--------------------------------------------------------------------------------------------------
+#define JOURNAL_MAGIC           0x4A535353      // "SSSJ"
+#define JOURNAL_VERSION         2
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Structure that holds the information associated with an item stored in the secure storage.
+ *
+ * The path and the data are stored right after the structure, in an allocation taken from the
+ * smallest size class that fits them.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    char* path;                 ///< Path, stored in buffer
+    uint8_t* data;              ///< Data, stored in buffer after the path
+    size_t size;                ///< Size of the data
+    size_t capacity;            ///< Size of buffer
+    bool isAvailable;           ///< Whether the entry has been deleted
+    char buffer[];              ///< Path and data
+}
+SecureStorageEntry_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size classes of the entries: number of bytes available for the path, its terminator and the
+ * data. The last class fits the largest path and item.
+ */
+//--------------------------------------------------------------------------------------------------
+static const size_t EntryClassSizes[] = {
+    64,
+    256,
+    1024,
+    4096,
+    SECSTOREADMIN_MAX_PATH_BYTES + LE_SECSTORE_MAX_ITEM_SIZE
+};
+
+#define ENTRY_CLASS_COUNT   NUM_ARRAY_MEMBERS(EntryClassSizes)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header of the journal file.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((packed)) {
+    uint32_t magic;                                 ///< JOURNAL_MAGIC
+    uint32_t version;                               ///< JOURNAL_VERSION
+}
+JournalHeader_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operations recorded in the journal.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum {
+    JOURNAL_OP_WRITE  = 1,      ///< Path and data of the entry
+    JOURNAL_OP_DELETE = 2,      ///< Path of the entry
+    JOURNAL_OP_MOVE   = 3       ///< Source and destination paths of the entry
+}
+JournalOp_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header of a journal record.
+ *
+ * It is followed by the path, the destination path and the data, without terminators. Lengths not
+ * relevant to the operation are 0.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct __attribute__((packed)) {
+    uint8_t op;                                     ///< JournalOp_t
+    uint16_t pathLen;                               ///< Length of the path
+    uint16_t destPathLen;                           ///< Length of the destination path
+    uint32_t dataLen;                               ///< Length of the data
+}
+JournalRecordHeader_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest journal record.
+ */
+//--------------------------------------------------------------------------------------------------
+#define JOURNAL_RECORD_MAX_BYTES    (sizeof(JournalRecordHeader_t) +                \
+                                     (2 * SECSTOREADMIN_MAX_PATH_BYTES) +           \
+                                     LE_SECSTORE_MAX_ITEM_SIZE)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fixed-size entry, as stored in legacy files.
  */
 //--------------------------------------------------------------------------------------------------
 typedef struct __attribute__((packed)) {
@@ -35,7 +139,35 @@ typedef struct __attribute__((packed)) {
     uint8_t data[LE_SECSTORE_MAX_ITEM_SIZE];
     bool isAvailable;
 }
-SecureStorageEntry_t;
+FixedEntry_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Buffer used to encode and decode journal records.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t RecordBuffer[JOURNAL_RECORD_MAX_BYTES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Journal file descriptor, opened for appending.
+ */
+//--------------------------------------------------------------------------------------------------
+static int JournalFd = -1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the journal file.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t JournalSize = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size the journal would have if it only held the live entries.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t JournalLiveSize = 0;
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -55,10 +187,10 @@ static le_hashmap_Ref_t Entries = NULL;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Pool of all SFS entries.
+ * Pools of all SFS entries, one per size class.
  */
 //--------------------------------------------------------------------------------------------------
-static le_mem_PoolRef_t EntriesPool = NULL;
+static le_mem_PoolRef_t EntriesPools[ENTRY_CLASS_COUNT];
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -76,16 +208,51 @@ static bool FsLoadInProgress = false;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Set the path of an entry.
+ * Allocate an entry from the smallest size class that fits its path and data.
+ *
+ * @return The entry, with its path set and room for the data.
+ */
+//--------------------------------------------------------------------------------------------------
+static SecureStorageEntry_t* AllocEntry
+(
+    const char *pathPtr,
+    size_t dataSize
+)
+{
+    size_t pathSize = strlen(pathPtr) + 1;
+    size_t classIdx;
+
+    LE_ASSERT(pathSize <= SECSTOREADMIN_MAX_PATH_BYTES);
+    LE_ASSERT(dataSize <= LE_SECSTORE_MAX_ITEM_SIZE);
+
+    for (classIdx = 0; EntryClassSizes[classIdx] < pathSize + dataSize; classIdx++)
+    {
+        LE_ASSERT(classIdx < ENTRY_CLASS_COUNT - 1);
+    }
+
+    SecureStorageEntry_t *entryPtr = le_mem_ForceAlloc(EntriesPools[classIdx]);
+    entryPtr->capacity = EntryClassSizes[classIdx];
+    entryPtr->path = entryPtr->buffer;
+    entryPtr->data = (uint8_t*)entryPtr->buffer + pathSize;
+    entryPtr->size = 0;
+    entryPtr->isAvailable = false;
+    memcpy(entryPtr->path, pathPtr, pathSize);
+
+    return entryPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if data of a given size fits in an entry, in addition to its path.
  */
 //--------------------------------------------------------------------------------------------------
-static void SetEntryPath
+static bool IsDataFitting
 (
-    SecureStorageEntry_t *entryPtr,
-    const char *pathPtr
+    const SecureStorageEntry_t *entryPtr,
+    size_t dataSize
 )
 {
-    LE_ASSERT_OK( le_utf8_Copy(entryPtr->path, pathPtr, sizeof(entryPtr->path), NULL) );
+    return ((entryPtr->data - (uint8_t*)entryPtr->buffer) + dataSize <= entryPtr->capacity);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -106,103 +273,222 @@ static void DeleteEntry
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Load entries from the file system.
+ * Write a whole buffer to a file, retrying on interruptions and partial writes.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FAULT         On error
  */
 //--------------------------------------------------------------------------------------------------
-static void LoadFileSystemEntries(void)
+static le_result_t WriteAll
+(
+    int fd,
+    const void* bufPtr,
+    size_t len
+)
 {
-    LE_INFO("Loading secStore from " SECSTORE_RECORD_PATH);
-
-    FsLoadInProgress = true;
+    const uint8_t* dataPtr = bufPtr;
 
-    int fd = open(SECSTORE_RECORD_PATH, O_RDONLY | O_NONBLOCK);
-    if (fd < 0)
+    while (len > 0)
     {
-        LE_WARN("Unable to open " SECSTORE_RECORD_PATH);
-        return;
+        ssize_t writeSz = write(fd, dataPtr, len);
+        if (writeSz < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LE_ERROR("Unable to write " SECSTORE_RECORD_PATH ": %m");
+            return LE_FAULT;
+        }
+
+        dataPtr += writeSz;
+        len -= writeSz;
     }
 
-    SecureStorageEntry_t entryBuffer;
-    size_t entryBufferPos = 0;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a buffer from a file, retrying on interruptions and partial reads.
+ *
+ * @return Number of bytes read, less than requested at the end of the file, or -1 on error.
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t ReadAll
+(
+    int fd,
+    void* bufPtr,
+    size_t len
+)
+{
+    uint8_t* dataPtr = bufPtr;
+    size_t readLen = 0;
 
-    while(true)
+    while (readLen < len)
     {
-        ssize_t readSz = 0;
-        readSz = read(fd,
-                      (uint8_t*)&(entryBuffer) + entryBufferPos,
-                      sizeof(entryBuffer) - entryBufferPos);
+        ssize_t readSz = read(fd, dataPtr + readLen, len - readLen);
         if (readSz < 0)
         {
-            if (errno != EINTR)
+            if (errno == EINTR)
             {
                 continue;
             }
 
-            LE_FATAL("There was an error reading " SECSTORE_RECORD_PATH ": %m");
+            LE_ERROR("There was an error reading " SECSTORE_RECORD_PATH ": %m");
+            return -1;
         }
         if (readSz == 0)
         {
-            LE_ASSERT(entryBufferPos == 0);
             break;
         }
 
-        entryBufferPos += readSz;
-        if (readSz < sizeof(entryBuffer))
-        {
-            continue;
-        }
+        readLen += readSz;
+    }
 
-        LE_ASSERT(entryBufferPos <= sizeof(entryBuffer));
-        LE_ASSERT(entryBuffer.isAvailable == true);
+    return readLen;
+}
 
-        LE_DEBUG("Loaded ... %s %zd", entryBuffer.path,
-                                      entryBuffer.size);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the journal for appending.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenJournal(void)
+{
+    JournalFd = open(SECSTORE_RECORD_PATH, O_WRONLY | O_APPEND);
+    if (JournalFd < 0)
+    {
+        LE_ERROR("Unable to open " SECSTORE_RECORD_PATH ": %m");
+    }
+}
 
-        // Load the entry in memory
-        pa_secStore_Write(entryBuffer.path,
-                          entryBuffer.data,
-                          entryBuffer.size);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the size of the record holding an entry in the journal.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetEntryRecordSize
+(
+    const SecureStorageEntry_t *entryPtr
+)
+{
+    return sizeof(JournalRecordHeader_t) + strlen(entryPtr->path) + entryPtr->size;
+}
 
-        entryBufferPos = 0;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a journal record in RecordBuffer.
+ *
+ * @return Size of the record.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t EncodeJournalRecord
+(
+    JournalOp_t op,                     ///< Operation
+    const char* pathPtr,                ///< Path of the entry
+    const char* destPathPtr,            ///< Destination path, for JOURNAL_OP_MOVE
+    const uint8_t* dataPtr,             ///< Data, for JOURNAL_OP_WRITE
+    size_t dataLen                      ///< Length of the data
+)
+{
+    JournalRecordHeader_t header = {
+        .op = op,
+        .pathLen = strlen(pathPtr),
+        .destPathLen = (NULL != destPathPtr) ? strlen(destPathPtr) : 0,
+        .dataLen = dataLen
+    };
+    uint8_t* ptr = RecordBuffer;
+
+    memcpy(ptr, &header, sizeof(header));
+    ptr += sizeof(header);
+    memcpy(ptr, pathPtr, header.pathLen);
+    ptr += header.pathLen;
+    if (header.destPathLen > 0)
+    {
+        memcpy(ptr, destPathPtr, header.destPathLen);
+        ptr += header.destPathLen;
+    }
+    if (dataLen > 0)
+    {
+        memcpy(ptr, dataPtr, dataLen);
+        ptr += dataLen;
     }
 
-    close(fd);
-
-    FsLoadInProgress = false;
+    return ptr - RecordBuffer;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Store all entries on the file system.
+ * Flush the directory holding the journal, so that a rename of the journal survives a power loss.
  */
 //--------------------------------------------------------------------------------------------------
-static void StoreFileSystemEntries(void)
+static void SyncJournalDirectory(void)
 {
-    if (FsLoadInProgress)
+    char dirPath[] = SECSTORE_RECORD_PATH;
+    char* slashPtr = strrchr(dirPath, '/');
+    int fd;
+
+    if (NULL == slashPtr)
     {
-        return;
+        strcpy(dirPath, ".");
+    }
+    else if (slashPtr == dirPath)
+    {
+        dirPath[1] = '\0';
+    }
+    else
+    {
+        *slashPtr = '\0';
     }
 
-    int fd = open(SECSTORE_RECORD_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    fd = open(dirPath, O_RDONLY | O_DIRECTORY);
     if (fd < 0)
     {
-        LE_ERROR("Unable to open/create " SECSTORE_RECORD_PATH);
+        LE_ERROR("Unable to open %s: %m", dirPath);
         return;
     }
+    if (fsync(fd) < 0)
+    {
+        LE_ERROR("Unable to sync %s: %m", dirPath);
+    }
+    close(fd);
+}
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rewrite the journal with only the live entries.
+ *
+ * The new journal is written aside, flushed, and then renamed over the current one, so that an
+ * interrupted compaction or a power loss leaves either the previous or the new journal intact.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompactJournal(void)
+{
+    JournalHeader_t header = { .magic = JOURNAL_MAGIC, .version = JOURNAL_VERSION };
     SecureStorageEntry_t *entryPtr = NULL;
     le_hashmap_It_Ref_t iter;
-    ssize_t writeSz = 0;
+    size_t size = sizeof(header);
+
+    int fd = open(SECSTORE_RECORD_PATH ".tmp", O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to open/create " SECSTORE_RECORD_PATH ".tmp");
+        return;
+    }
+
+    if (LE_OK != WriteAll(fd, &header, sizeof(header)))
+    {
+        goto error;
+    }
 
     /* Iterate through entries */
     iter = le_hashmap_GetIterator(Entries);
     while (LE_OK == le_hashmap_NextNode(iter))
     {
-        if (writeSz >= 0)
-        {
-            entryPtr = (SecureStorageEntry_t*)le_hashmap_GetValue(iter);
-        }
-
+        entryPtr = (SecureStorageEntry_t*)le_hashmap_GetValue(iter);
         LE_ASSERT(entryPtr);
 
         if (!(entryPtr->isAvailable))
@@ -213,24 +499,285 @@ static void StoreFileSystemEntries(void)
         }
 
         LE_DEBUG("Saving %s", entryPtr->path);
-        writeSz = write(fd, entryPtr, sizeof(SecureStorageEntry_t));
-        if (writeSz < 0)
+        size_t recordSize = EncodeJournalRecord(JOURNAL_OP_WRITE, entryPtr->path, NULL,
+                                                entryPtr->data, entryPtr->size);
+        if (LE_OK != WriteAll(fd, RecordBuffer, recordSize))
         {
-            if (errno == EINTR)
-            {
-                // Retry to write the same entry on the next loop
-                continue;
-            }
-
-            LE_FATAL("Unable to write " SECSTORE_RECORD_PATH ": %m");
+            goto error;
         }
+        size += recordSize;
+    }
+
+    if (fsync(fd) < 0)
+    {
+        LE_ERROR("Unable to sync " SECSTORE_RECORD_PATH ".tmp: %m");
+        goto error;
+    }
+    close(fd);
 
-        LE_ASSERT(writeSz == sizeof(SecureStorageEntry_t));
+    if (rename(SECSTORE_RECORD_PATH ".tmp", SECSTORE_RECORD_PATH) < 0)
+    {
+        LE_ERROR("Unable to replace " SECSTORE_RECORD_PATH ": %m");
+        unlink(SECSTORE_RECORD_PATH ".tmp");
+        return;
     }
+    SyncJournalDirectory();
+
+    LE_INFO("Compacted " SECSTORE_RECORD_PATH " from %zu to %zu bytes", JournalSize, size);
+    JournalSize = size;
+    JournalLiveSize = size;
 
+    // Append to the new file from now on
+    if (JournalFd >= 0)
+    {
+        close(JournalFd);
+    }
+    OpenJournal();
+    return;
+
+error:
     close(fd);
+    unlink(SECSTORE_RECORD_PATH ".tmp");
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a record to the journal, and compact the journal if it holds too many stale records.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AppendJournalRecord
+(
+    JournalOp_t op,                     ///< Operation
+    const char* pathPtr,                ///< Path of the entry
+    const char* destPathPtr,            ///< Destination path, for JOURNAL_OP_MOVE
+    const uint8_t* dataPtr,             ///< Data, for JOURNAL_OP_WRITE
+    size_t dataLen                      ///< Length of the data
+)
+{
+    if (FsLoadInProgress)
+    {
+        return;
+    }
+
+    if (JournalFd < 0)
+    {
+        // No usable journal, start a new one
+        CompactJournal();
+        return;
+    }
+
+    size_t recordSize = EncodeJournalRecord(op, pathPtr, destPathPtr, dataPtr, dataLen);
+    if (LE_OK != WriteAll(JournalFd, RecordBuffer, recordSize))
+    {
+        // The journal may end with a partial record, start a new one
+        CompactJournal();
+        return;
+    }
+    JournalSize += recordSize;
+
+    if ( (JournalSize - JournalLiveSize > SECSTORE_COMPACT_MIN_BYTES) &&
+         (JournalSize - JournalLiveSize > JournalLiveSize) )
+    {
+        CompactJournal();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Replay one operation of the journal.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReplayJournalRecord
+(
+    JournalOp_t op,                     ///< Operation
+    const char* pathPtr,                ///< Path of the entry
+    const char* destPathPtr,            ///< Destination path, for JOURNAL_OP_MOVE
+    const uint8_t* dataPtr,             ///< Data, for JOURNAL_OP_WRITE
+    size_t dataLen                      ///< Length of the data
+)
+{
+    switch (op)
+    {
+        case JOURNAL_OP_WRITE:
+            LE_DEBUG("Loaded ... %s %zd", pathPtr, dataLen);
+            pa_secStore_Write(pathPtr, dataPtr, dataLen);
+            break;
+
+        case JOURNAL_OP_DELETE:
+            pa_secStore_Delete(pathPtr);
+            break;
+
+        case JOURNAL_OP_MOVE:
+            pa_secStore_Move(destPathPtr, pathPtr);
+            break;
+
+        default:
+            LE_ASSERT(false);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the fixed-size entries of a legacy file.
+ *
+ * @return Size of the complete entries read.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t LoadLegacyEntries
+(
+    int fd                              ///< File, positioned on the first entry
+)
+{
+    static FixedEntry_t entry;
+    size_t offset = 0;
+
+    while (true)
+    {
+        ssize_t readSz = ReadAll(fd, &entry, sizeof(entry));
+
+        if (readSz == 0)
+        {
+            return offset;
+        }
+        if ( (readSz != sizeof(entry)) || (entry.size > LE_SECSTORE_MAX_ITEM_SIZE) )
+        {
+            LE_WARN("Dropping incomplete entry at %zu", offset);
+            return offset;
+        }
+
+        // Paths are stored in fixed-size, zero-padded fields
+        entry.path[sizeof(entry.path) - 1] = '\0';
+        ReplayJournalRecord(JOURNAL_OP_WRITE, entry.path, NULL, entry.data, entry.size);
+        offset += sizeof(entry);
+    }
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the length-prefixed records of a journal.
+ *
+ * @return Size of the complete records read.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t LoadJournalRecords
+(
+    int fd                              ///< File, positioned on the first record
+)
+{
+    char path[SECSTOREADMIN_MAX_PATH_BYTES];
+    char destPath[SECSTOREADMIN_MAX_PATH_BYTES];
+    size_t offset = 0;
+
+    while (true)
+    {
+        JournalRecordHeader_t header;
+        ssize_t readSz = ReadAll(fd, &header, sizeof(header));
+        size_t bodySize;
+
+        if (readSz == 0)
+        {
+            return offset;
+        }
+        if (readSz != sizeof(header))
+        {
+            LE_WARN("Dropping incomplete record at %zu", offset);
+            return offset;
+        }
+
+        if ( (header.pathLen == 0) || (header.pathLen >= sizeof(path)) ||
+             (header.destPathLen >= sizeof(destPath)) ||
+             (header.dataLen > LE_SECSTORE_MAX_ITEM_SIZE) ||
+             ( (JOURNAL_OP_WRITE != header.op) && (header.dataLen != 0) ) ||
+             ( (JOURNAL_OP_MOVE == header.op) != (header.destPathLen != 0) ) ||
+             ( (JOURNAL_OP_WRITE != header.op) && (JOURNAL_OP_DELETE != header.op) &&
+               (JOURNAL_OP_MOVE != header.op) ) )
+        {
+            LE_ERROR("Invalid record %u at %zu", header.op, offset);
+            return offset;
+        }
+
+        bodySize = header.pathLen + header.destPathLen + header.dataLen;
+        if (ReadAll(fd, RecordBuffer, bodySize) != (ssize_t)bodySize)
+        {
+            LE_WARN("Dropping incomplete record at %zu", offset);
+            return offset;
+        }
+
+        memcpy(path, RecordBuffer, header.pathLen);
+        path[header.pathLen] = '\0';
+        memcpy(destPath, RecordBuffer + header.pathLen, header.destPathLen);
+        destPath[header.destPathLen] = '\0';
+
+        ReplayJournalRecord(header.op, path, destPath,
+                            RecordBuffer + header.pathLen + header.destPathLen, header.dataLen);
+        offset += sizeof(header) + bodySize;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load entries from the file system.
+ *
+ * The journal is replayed; a record interrupted by a crash is dropped. Legacy files are loaded, and
+ * then converted to a journal.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadFileSystemEntries(void)
+{
+    JournalHeader_t header;
+    bool isConverted = false;
+    size_t size;
+
+    LE_INFO("Loading secStore from " SECSTORE_RECORD_PATH);
+
+    int fd = open(SECSTORE_RECORD_PATH, O_RDONLY);
+    if (fd < 0)
+    {
+        LE_WARN("Unable to open " SECSTORE_RECORD_PATH);
+        CompactJournal();
+        return;
+    }
+
+    FsLoadInProgress = true;
+    JournalLiveSize = sizeof(header);
+
+    size = ReadAll(fd, &header, sizeof(header));
+    if ( (size != sizeof(header)) || (JOURNAL_MAGIC != header.magic) )
+    {
+        LE_INFO("Converting legacy " SECSTORE_RECORD_PATH);
+        lseek(fd, 0, SEEK_SET);
+        size = LoadLegacyEntries(fd);
+        isConverted = true;
+    }
+    else if (JOURNAL_VERSION == header.version)
+    {
+        size += LoadJournalRecords(fd);
+    }
+    else
+    {
+        LE_FATAL("Unsupported version %"PRIu32" of " SECSTORE_RECORD_PATH, header.version);
+    }
+
+    close(fd);
+
+    FsLoadInProgress = false;
+
+    JournalSize = size;
+    if ( isConverted || (JournalSize - JournalLiveSize > SECSTORE_COMPACT_MIN_BYTES) )
+    {
+        CompactJournal();
+    }
+    else
+    {
+        // Drop what follows the last valid record, so that new records are appended after it
+        if (truncate(SECSTORE_RECORD_PATH, JournalSize) < 0)
+        {
+            LE_ERROR("Unable to truncate " SECSTORE_RECORD_PATH ": %m");
+        }
+        OpenJournal();
+    }
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -319,13 +866,25 @@ LE_SHARED le_result_t pa_secStore_Write
         return LE_NO_MEMORY;
     }
 
-    // Allocate a new element if needed
+    // The previous record of the entry, if any, becomes stale
+    if ( (NULL != entryPtr) && (entryPtr->isAvailable) )
+    {
+        JournalLiveSize -= GetEntryRecordSize(entryPtr);
+    }
+
+    // Allocate a new element if needed, the existing one being reused if the data fits in it
     if (NULL == entryPtr)
     {
         LE_INFO("Write new entry");
-        entryPtr = (SecureStorageEntry_t*)le_mem_ForceAlloc(EntriesPool);
-        memset(entryPtr, 0xFF, sizeof(SecureStorageEntry_t));
-        SetEntryPath(entryPtr, pathPtr);
+        entryPtr = AllocEntry(pathPtr, bufSize);
+        le_hashmap_Put(Entries, entryPtr->path, entryPtr);
+    }
+    else if (!IsDataFitting(entryPtr, bufSize))
+    {
+        LE_INFO("Write entry in a larger size class");
+        le_hashmap_Remove(Entries, pathPtr);
+        le_mem_Release(entryPtr);
+        entryPtr = AllocEntry(pathPtr, bufSize);
         le_hashmap_Put(Entries, entryPtr->path, entryPtr);
     }
 
@@ -335,7 +894,8 @@ LE_SHARED le_result_t pa_secStore_Write
     entryPtr->isAvailable = true;
 
     // Save on disk
-    StoreFileSystemEntries();
+    JournalLiveSize += GetEntryRecordSize(entryPtr);
+    AppendJournalRecord(JOURNAL_OP_WRITE, pathPtr, NULL, bufPtr, bufSize);
 
     return LE_OK;
 }
@@ -441,10 +1001,11 @@ LE_SHARED le_result_t pa_secStore_Delete
         return LE_NOT_FOUND;
     }
 
+    JournalLiveSize -= GetEntryRecordSize(entryPtr);
     DeleteEntry(entryPtr);
 
     // Save on disk
-    StoreFileSystemEntries();
+    AppendJournalRecord(JOURNAL_OP_DELETE, pathPtr, NULL, NULL, 0);
 
     return LE_OK;
 }
@@ -619,11 +1180,31 @@ LE_SHARED le_result_t pa_secStore_Move
         return LE_OK;
     }
 
-    // 'Move' entry
-    SetEntryPath(entryPtr, destPathPtr);
+    // Replace the destination, if any
+    SecureStorageEntry_t *destEntryPtr = le_hashmap_Remove(Entries, destPathPtr);
+    if (NULL != destEntryPtr)
+    {
+        if (destEntryPtr->isAvailable)
+        {
+            JournalLiveSize -= GetEntryRecordSize(destEntryPtr);
+        }
+        le_mem_Release(destEntryPtr);
+    }
+
+    // 'Move' entry: the path is stored with the data, so it is copied under its new path
+    SecureStorageEntry_t *movedEntryPtr = AllocEntry(destPathPtr, entryPtr->size);
+    movedEntryPtr->size = entryPtr->size;
+    memcpy(movedEntryPtr->data, entryPtr->data, entryPtr->size);
+    movedEntryPtr->isAvailable = true;
+
+    JournalLiveSize -= GetEntryRecordSize(entryPtr);
+    le_hashmap_Remove(Entries, srcPathPtr);
+    le_mem_Release(entryPtr);
+    le_hashmap_Put(Entries, movedEntryPtr->path, movedEntryPtr);
+    JournalLiveSize += GetEntryRecordSize(movedEntryPtr);
 
     // Save on disk
-    StoreFileSystemEntries();
+    AppendJournalRecord(JOURNAL_OP_MOVE, srcPathPtr, destPathPtr, NULL, 0);
 
     return LE_OK;
 }
@@ -668,8 +1249,16 @@ COMPONENT_INIT
                                 le_hashmap_HashString,
                                 le_hashmap_EqualsString);
 
-    // Create a memory pool to store the data
-    EntriesPool = le_mem_CreatePool("secStoreEntriesPool", sizeof(SecureStorageEntry_t));
+    // Create the memory pools to store the data, one per size class
+    size_t classIdx;
+    for (classIdx = 0; classIdx < ENTRY_CLASS_COUNT; classIdx++)
+    {
+        char poolName[32];
+
+        snprintf(poolName, sizeof(poolName), "secStoreEntries%zu", EntryClassSizes[classIdx]);
+        EntriesPools[classIdx] = le_mem_CreatePool(poolName, sizeof(SecureStorageEntry_t) +
+                                                             EntryClassSizes[classIdx]);
+    }
 
     // Load from file system
     LoadFileSystemEntries();
@@ -7,214 +7,1862 @@
  * For instance, to set the Platform Serial Number:
  * @verbatim config set /simulation/modem/info/fsn TESTFSN @endverbatim
  *
+ * A whole simulated device can also be described in a profile file, loaded once at start-up and
+ * applied to each service as it registers, before the config tree. The file named by the
+ * SIMUCONFIG_PROFILE environment variable holds one "<service>.<property> = <value>" entry per
+ * line; empty lines and lines starting with '#' are ignored. Values are converted to the type of
+ * the property setter, binary values being written in base64. For instance:
+ * @verbatim
+ * sim.state = READY
+ * sim.pinSecurity = false
+ * info.imei = 359377060000000
+ * @endverbatim
+ *
+ * The values applied to all the services can be saved and restored at once, either through
+ * simuConfig_Snapshot() and simuConfig_Restore(), or by naming a snapshot in the config tree:
+ * @verbatim
+ * config set /simulation/control/snapshot testCase
+ * config set /simulation/control/restore testCase
+ * @endverbatim
+ * Snapshots taken this way are kept as binary nodes under /simulation/snapshots. They only hold the
+ * values of the properties: the runtime state of the platform adaptors, such as the stored messages
+ * or the PIN attempt counters, is not saved nor restored.
+ *
+ * The apply and setter statistics of the services are published on demand under /simulation/stats:
+ * @verbatim config set /simulation/control/stats true -t bool @endverbatim
+ *
  * Copyright (C) Sierra Wireless Inc.
  */
 
-#include "legato.h"
-#include "interfaces.h"
-#include "simuConfig.h"
+#include "legato.h"
+#include "interfaces.h"
+#include "simuConfig.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Property of a registered service, with the last value applied through its setter.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    const simuConfig_Property_t* propPtr;   ///< Property description
+    bool isApplied;                         ///< A value has been applied since it was last seen
+    bool isSet;                             ///< A value, from the tree, the profile or a
+                                            ///  snapshot, is in effect in the service
+    uint32_t seenGeneration;                ///< Last tree walk in which the entry was found
+    le_cfg_nodeType_t nodeType;             ///< Node type of the applied value
+    union {
+        char stringValue[LE_CFG_STR_LEN_BYTES];
+        bool boolValue;
+        int32_t intValue;
+        double floatValue;
+        struct {
+            uint8_t data[SIMUCONFIG_BLOB_MAX_BYTES];
+            size_t len;
+        } blobValue;
+    } value;                                ///< Applied value
+    uint32_t setterCnt;                     ///< Calls to the setter
+    uint64_t lastSetterUs;                  ///< Duration of the last setter call
+    uint64_t maxSetterUs;                   ///< Longest setter call
+    uint64_t totalSetterUs;                 ///< Cumulated duration of the setter calls
+}
+ConfigProperty_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Registered service.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    simuConfig_Service_t service;       ///< Copy of the service description
+    le_hashmap_Ref_t propertiesMap;     ///< Properties of the service (ConfigProperty_t), by name
+    uint32_t generation;                ///< Counter of tree walks
+    le_timer_Ref_t changeTimer;         ///< Timer coalescing the change notifications
+    uint32_t pendingChangeCnt;          ///< Notifications received since the last apply pass
+    uint32_t foldedChangeCnt;           ///< Notifications merged into another apply pass
+    uint32_t maxDepth;                  ///< Deepest stem level walked
+    uint32_t maxNodes;                  ///< Nodes visited in one apply pass
+    uint32_t applyCnt;                  ///< Apply passes done
+    uint32_t lastNodeCnt;               ///< Nodes visited by the last apply pass
+    uint64_t lastApplyUs;               ///< Duration of the last apply pass
+    uint64_t maxApplyUs;                ///< Longest apply pass
+    uint64_t totalApplyUs;              ///< Cumulated duration of the apply passes
+    le_clk_Time_t firstChangeTime;      ///< Reception of the first pending notification
+    uint32_t latencyCnt;                ///< Changes applied after a notification
+    uint64_t lastLatencyUs;             ///< Last delay between notification and applied change
+    uint64_t maxLatencyUs;              ///< Longest delay between notification and applied change
+    uint64_t totalLatencyUs;            ///< Cumulated delay between notification and applied change
+}
+ConfigService_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Config tree nodes used to take and restore named snapshots, and to publish the statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CONTROL_ROOT            "/simulation/control"
+#define CONTROL_SNAPSHOT_NODE   "snapshot"
+#define CONTROL_RESTORE_NODE    "restore"
+#define CONTROL_STATS_NODE      "stats"
+#define SNAPSHOTS_ROOT          "/simulation/snapshots"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Config tree root where the statistics of the services are published on request, see
+ * simuConfig_DumpStats(). The content is overwritten by simuConfig and is not meant to be modified.
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_ROOT              "/simulation/stats"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Snapshot format.
+ *
+ * A header (magic, version, service count) is followed by each service: its name, its property
+ * count and, for each property, its name, the node type of the value and the value. Names are
+ * prefixed by a 1-byte length, values by a 2-byte length; integers are in host order, snapshots
+ * are not meant to be exchanged between platforms. A property without a value in effect is
+ * recorded with the LE_CFG_TYPE_DOESNT_EXIST node type and an empty value, and is put back to its
+ * default on restore.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNAPSHOT_MAGIC          0x53434647      // "SCFG"
+#define SNAPSHOT_VERSION        1
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Environment variable giving the path of the profile file.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PROFILE_PATH_ENV        "SIMUCONFIG_PROFILE"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of a service or property name in the profile file, including the terminator.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PROFILE_NAME_BYTES      64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Entry of the profile file, waiting for its service to register.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    le_dls_Link_t link;                             ///< Link in ProfileEntries
+    char serviceName[PROFILE_NAME_BYTES];           ///< Name of the service
+    char propertyName[PROFILE_NAME_BYTES];          ///< Name of the property
+    char value[LE_CFG_STR_LEN_BYTES];               ///< Value, as written in the file
+}
+ProfileEntry_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of the profile entries.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t ProfileEntriesPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Profile entries not yet applied.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t ProfileEntries = LE_DLS_LIST_INIT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of the properties of all registered services.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t ConfigPropertiesPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of all registered services.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t ConfigServicesPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hashmap of all registered services.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_hashmap_Ref_t ConfigServicesMap = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a property structure of a service with the given name.
+ */
+//--------------------------------------------------------------------------------------------------
+static ConfigProperty_t* FindProperty
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    const char* propertyNamePtr         ///< Property name to find
+)
+{
+    ConfigProperty_t* propPtr = le_hashmap_Get(servicePtr->propertiesMap, propertyNamePtr);
+
+    if (NULL == propPtr)
+    {
+        LE_DEBUG("Property for [%s][%s] not found", servicePtr->service.namePtr, propertyNamePtr);
+    }
+
+    return propPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time elapsed since a given relative time, in microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetElapsedUs
+(
+    le_clk_Time_t startTime         ///< Relative start time
+)
+{
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    return ((uint64_t)duration.sec * 1000000) + duration.usec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a call to the setter of a property.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordSetterCall
+(
+    ConfigProperty_t* cachePtr,     ///< Property which setter has been called
+    le_clk_Time_t startTime         ///< Relative time at which the setter was called
+)
+{
+    uint64_t durationUs = GetElapsedUs(startTime);
+
+    cachePtr->setterCnt++;
+    cachePtr->lastSetterUs = durationUs;
+    cachePtr->totalSetterUs += durationUs;
+    if (durationUs > cachePtr->maxSetterUs)
+    {
+        cachePtr->maxSetterUs = durationUs;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a string value to a property.
+ *
+ * The setter is only called if the value differs from the one last applied, so that a change
+ * on one entry of the service does not re-trigger the side effects of all the other setters.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyStringValue
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    const char* valuePtr                ///< Value to apply
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    const simuConfig_Property_t* propPtr = cachePtr->propPtr;
+
+    if (cachePtr->isApplied && (LE_CFG_TYPE_STRING == cachePtr->nodeType) &&
+        (0 == strcmp(cachePtr->value.stringValue, valuePtr)))
+    {
+        LE_DEBUG("Unchanged %s.%s", parentNamePtr, propPtr->name);
+        return;
+    }
+
+    LE_DEBUG("Setting %s.%s: %s", parentNamePtr, propPtr->name, valuePtr);
+
+    cachePtr->isApplied = true;
+    cachePtr->isSet = true;
+    cachePtr->nodeType = LE_CFG_TYPE_STRING;
+    LE_ASSERT(le_utf8_Copy(cachePtr->value.stringValue, valuePtr,
+                           sizeof(cachePtr->value.stringValue), NULL) == LE_OK);
+
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+
+    switch(propPtr->setter.type)
+    {
+        case SIMUCONFIG_HANDLER_STRING:
+            propPtr->setter.handler.stringFn(valuePtr);
+            break;
+
+        case SIMUCONFIG_HANDLER_COMPLEX:
+            propPtr->setter.handler.complexFn(parentNamePtr, propPtr->name, valuePtr);
+            break;
+
+        default:
+            LE_ERROR("Entry %s.%s is not expecting a string, Ignoring value.",
+                     parentNamePtr, propPtr->name);
+            break;
+    }
+
+    RecordSetterCall(cachePtr, startTime);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a bool value to a property.
+ *
+ * As for strings, the setter is only called if the value changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyBoolValue
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    bool value                          ///< Value to apply
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    const simuConfig_Property_t* propPtr = cachePtr->propPtr;
+
+    if (cachePtr->isApplied && (LE_CFG_TYPE_BOOL == cachePtr->nodeType) &&
+        (cachePtr->value.boolValue == value))
+    {
+        LE_DEBUG("Unchanged %s.%s", parentNamePtr, propPtr->name);
+        return;
+    }
+
+    LE_DEBUG("Setting %s.%s: %s", parentNamePtr, propPtr->name, value ? "true" : "false");
+
+    cachePtr->isApplied = true;
+    cachePtr->isSet = true;
+    cachePtr->nodeType = LE_CFG_TYPE_BOOL;
+    cachePtr->value.boolValue = value;
+
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+
+    switch(propPtr->setter.type)
+    {
+        case SIMUCONFIG_HANDLER_BOOL:
+            propPtr->setter.handler.boolFn(value);
+            break;
+
+        case SIMUCONFIG_HANDLER_COMPLEX:
+            propPtr->setter.handler.complexFn(parentNamePtr, propPtr->name, &value);
+            break;
+
+        default:
+            LE_ERROR("Entry %s.%s is not expecting a bool, Ignoring value.",
+                     parentNamePtr, propPtr->name);
+            break;
+    }
+
+    RecordSetterCall(cachePtr, startTime);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply an integer value to a property.
+ *
+ * As for strings, the setter is only called if the value changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyIntValue
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    int32_t value                       ///< Value to apply
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    const simuConfig_Property_t* propPtr = cachePtr->propPtr;
+
+    if (cachePtr->isApplied && (LE_CFG_TYPE_INT == cachePtr->nodeType) &&
+        (cachePtr->value.intValue == value))
+    {
+        LE_DEBUG("Unchanged %s.%s", parentNamePtr, propPtr->name);
+        return;
+    }
+
+    LE_DEBUG("Setting %s.%s: %"PRId32, parentNamePtr, propPtr->name, value);
+
+    cachePtr->isApplied = true;
+    cachePtr->isSet = true;
+    cachePtr->nodeType = LE_CFG_TYPE_INT;
+    cachePtr->value.intValue = value;
+
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+
+    switch(propPtr->setter.type)
+    {
+        case SIMUCONFIG_HANDLER_INT:
+            propPtr->setter.handler.intFn(value);
+            break;
+
+        case SIMUCONFIG_HANDLER_FLOAT:
+            propPtr->setter.handler.floatFn((double)value);
+            break;
+
+        case SIMUCONFIG_HANDLER_COMPLEX:
+            propPtr->setter.handler.complexFn(parentNamePtr, propPtr->name, &value);
+            break;
+
+        default:
+            LE_ERROR("Entry %s.%s is not expecting an integer, Ignoring value.",
+                     parentNamePtr, propPtr->name);
+            break;
+    }
+
+    RecordSetterCall(cachePtr, startTime);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a floating point value to a property.
+ *
+ * As for strings, the setter is only called if the value changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyFloatValue
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    double value                        ///< Value to apply
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    const simuConfig_Property_t* propPtr = cachePtr->propPtr;
+
+    if (cachePtr->isApplied && (LE_CFG_TYPE_FLOAT == cachePtr->nodeType) &&
+        (cachePtr->value.floatValue == value))
+    {
+        LE_DEBUG("Unchanged %s.%s", parentNamePtr, propPtr->name);
+        return;
+    }
+
+    LE_DEBUG("Setting %s.%s: %g", parentNamePtr, propPtr->name, value);
+
+    cachePtr->isApplied = true;
+    cachePtr->isSet = true;
+    cachePtr->nodeType = LE_CFG_TYPE_FLOAT;
+    cachePtr->value.floatValue = value;
+
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+
+    switch(propPtr->setter.type)
+    {
+        case SIMUCONFIG_HANDLER_FLOAT:
+            propPtr->setter.handler.floatFn(value);
+            break;
+
+        case SIMUCONFIG_HANDLER_COMPLEX:
+            propPtr->setter.handler.complexFn(parentNamePtr, propPtr->name, &value);
+            break;
+
+        default:
+            LE_ERROR("Entry %s.%s is not expecting a float, Ignoring value.",
+                     parentNamePtr, propPtr->name);
+            break;
+    }
+
+    RecordSetterCall(cachePtr, startTime);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a binary value to a BLOB property.
+ *
+ * As for strings, the setter is only called if the value changed. Binary values have no node type
+ * of their own in the tree, they are cached under LE_CFG_TYPE_EMPTY.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyBlobValue
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    const uint8_t* dataPtr,             ///< Value to apply
+    size_t dataLen                      ///< Length of the value
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    const simuConfig_Property_t* propPtr = cachePtr->propPtr;
+
+    LE_ASSERT(dataLen <= sizeof(cachePtr->value.blobValue.data));
+
+    if (cachePtr->isApplied && (LE_CFG_TYPE_EMPTY == cachePtr->nodeType) &&
+        (cachePtr->value.blobValue.len == dataLen) &&
+        (0 == memcmp(cachePtr->value.blobValue.data, dataPtr, dataLen)))
+    {
+        LE_DEBUG("Unchanged %s.%s", parentNamePtr, propPtr->name);
+        return;
+    }
+
+    LE_DEBUG("Setting %s.%s: %zu bytes", parentNamePtr, propPtr->name, dataLen);
+
+    cachePtr->isApplied = true;
+    cachePtr->isSet = true;
+    cachePtr->nodeType = LE_CFG_TYPE_EMPTY;
+    memcpy(cachePtr->value.blobValue.data, dataPtr, dataLen);
+    cachePtr->value.blobValue.len = dataLen;
+
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+
+    propPtr->setter.handler.blobFn(dataPtr, dataLen);
+
+    RecordSetterCall(cachePtr, startTime);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a value written as a string, in the profile file or as a string node of the Config tree,
+ * to the type expected by the setter of a property, and apply it.
+ *
+ * @return
+ *      - LE_OK            The value has been applied
+ *      - LE_FORMAT_ERROR  The value does not match the type of the property
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ApplyValueFromString
+(
+    const ConfigService_t* servicePtr,  ///< Service
+    ConfigProperty_t* cachePtr,         ///< Property to set
+    const char* valuePtr                ///< Value, as a string
+)
+{
+    char* endPtr;
+
+    switch (cachePtr->propPtr->setter.type)
+    {
+        case SIMUCONFIG_HANDLER_BOOL:
+            if ((0 == strcmp(valuePtr, "true")) || (0 == strcmp(valuePtr, "1")))
+            {
+                ApplyBoolValue(servicePtr, cachePtr, true);
+            }
+            else if ((0 == strcmp(valuePtr, "false")) || (0 == strcmp(valuePtr, "0")))
+            {
+                ApplyBoolValue(servicePtr, cachePtr, false);
+            }
+            else
+            {
+                return LE_FORMAT_ERROR;
+            }
+            break;
+
+        case SIMUCONFIG_HANDLER_INT:
+        {
+            long value;
+
+            errno = 0;
+            value = strtol(valuePtr, &endPtr, 0);
+            if ((0 != errno) || (endPtr == valuePtr) || ('\0' != *endPtr) ||
+                (value < INT32_MIN) || (value > INT32_MAX))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            ApplyIntValue(servicePtr, cachePtr, (int32_t)value);
+            break;
+        }
+
+        case SIMUCONFIG_HANDLER_FLOAT:
+        {
+            double value;
+
+            errno = 0;
+            value = strtod(valuePtr, &endPtr);
+            if ((0 != errno) || (endPtr == valuePtr) || ('\0' != *endPtr))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            ApplyFloatValue(servicePtr, cachePtr, value);
+            break;
+        }
+
+        case SIMUCONFIG_HANDLER_BLOB:
+        {
+            uint8_t blobBuffer[SIMUCONFIG_BLOB_MAX_BYTES];
+            size_t blobLen = sizeof(blobBuffer);
+
+            if (le_base64_Decode(valuePtr, strlen(valuePtr), blobBuffer, &blobLen) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            ApplyBlobValue(servicePtr, cachePtr, blobBuffer, blobLen);
+            break;
+        }
+
+        default:
+            ApplyStringValue(servicePtr, cachePtr, valuePtr);
+            break;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an entry from the Config tree.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleConfigEntry
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const ConfigService_t* servicePtr,
+    const char* entryNamePtr
+)
+{
+    const char* parentNamePtr = servicePtr->service.namePtr;
+    le_cfg_nodeType_t nodeType = le_cfg_GetNodeType(iteratorRef, "");
+
+    // Find the property
+    ConfigProperty_t* cachePtr = FindProperty(servicePtr, entryNamePtr);
+
+    if (cachePtr == NULL)
+    {
+        LE_INFO("Ignoring entry %s.%s", parentNamePtr, entryNamePtr);
+        return;
+    }
+
+    cachePtr->seenGeneration = servicePtr->generation;
+
+    switch(nodeType)
+    {
+        case LE_CFG_TYPE_STRING:
+        {
+            if (SIMUCONFIG_HANDLER_BLOB == cachePtr->propPtr->setter.type)
+            {
+                uint8_t blobBuffer[SIMUCONFIG_BLOB_MAX_BYTES];
+                size_t blobLen = sizeof(blobBuffer);
+
+                if (le_cfg_GetBinary(iteratorRef, "", blobBuffer, &blobLen, NULL, 0) != LE_OK)
+                {
+                    LE_ERROR("Entry %s.%s is not a valid binary value, Ignoring value.",
+                             parentNamePtr, entryNamePtr);
+                    break;
+                }
+
+                ApplyBlobValue(servicePtr, cachePtr, blobBuffer, blobLen);
+                break;
+            }
+
+            char stringBuffer[LE_CFG_STR_LEN_BYTES];
+
+            LE_ASSERT(le_cfg_GetString(iteratorRef,
+                                       "",
+                                       stringBuffer,
+                                       sizeof(stringBuffer),
+                                       "") == LE_OK);
+
+            if (SIMUCONFIG_HANDLER_STRING == cachePtr->propPtr->setter.type)
+            {
+                ApplyStringValue(servicePtr, cachePtr, stringBuffer);
+            }
+            else if (ApplyValueFromString(servicePtr, cachePtr, stringBuffer) != LE_OK)
+            {
+                LE_ERROR("Entry %s.%s: invalid value '%s', Ignoring value.",
+                         parentNamePtr, entryNamePtr, stringBuffer);
+            }
+            break;
+        }
+
+        case LE_CFG_TYPE_BOOL:
+            ApplyBoolValue(servicePtr, cachePtr, le_cfg_GetBool(iteratorRef, "", false));
+            break;
+
+        case LE_CFG_TYPE_INT:
+            ApplyIntValue(servicePtr, cachePtr, le_cfg_GetInt(iteratorRef, "", 0));
+            break;
+
+        case LE_CFG_TYPE_FLOAT:
+            ApplyFloatValue(servicePtr, cachePtr, le_cfg_GetFloat(iteratorRef, "", 0.0));
+            break;
+
+        default:
+            LE_ERROR("Node type %d not handled", nodeType);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Strip the leading and trailing blanks of a string, in place.
+ *
+ * @return Pointer to the first non-blank character.
+ */
+//--------------------------------------------------------------------------------------------------
+static char* StripBlanks
+(
+    char* strPtr
+)
+{
+    size_t len;
+
+    while (isspace((unsigned char)*strPtr))
+    {
+        strPtr++;
+    }
+
+    len = strlen(strPtr);
+    while ((len > 0) && isspace((unsigned char)strPtr[len - 1]))
+    {
+        strPtr[--len] = '\0';
+    }
+
+    return strPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse one line of the profile file and queue the corresponding entry.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseProfileLine
+(
+    const char* pathPtr,            ///< Path of the profile file, for logs
+    unsigned int lineNum,           ///< Line number, for logs
+    char* linePtr                   ///< Line content, modified while parsing
+)
+{
+    char* keyPtr = StripBlanks(linePtr);
+    char* valuePtr;
+    char* propertyPtr;
+
+    if (('\0' == *keyPtr) || ('#' == *keyPtr))
+    {
+        return;
+    }
+
+    valuePtr = strchr(keyPtr, '=');
+    if (NULL == valuePtr)
+    {
+        LE_WARN("%s:%u: missing '=', ignoring line", pathPtr, lineNum);
+        return;
+    }
+    *valuePtr++ = '\0';
+    keyPtr = StripBlanks(keyPtr);
+    valuePtr = StripBlanks(valuePtr);
+
+    propertyPtr = strchr(keyPtr, '.');
+    if ((NULL == propertyPtr) || (propertyPtr == keyPtr) || ('\0' == propertyPtr[1]))
+    {
+        LE_WARN("%s:%u: key '%s' is not <service>.<property>, ignoring line",
+                pathPtr, lineNum, keyPtr);
+        return;
+    }
+    *propertyPtr++ = '\0';
+
+    ProfileEntry_t* entryPtr = le_mem_ForceAlloc(ProfileEntriesPool);
+    entryPtr->link = LE_DLS_LINK_INIT;
+    if ((le_utf8_Copy(entryPtr->serviceName, keyPtr, sizeof(entryPtr->serviceName), NULL)
+         != LE_OK) ||
+        (le_utf8_Copy(entryPtr->propertyName, propertyPtr, sizeof(entryPtr->propertyName), NULL)
+         != LE_OK) ||
+        (le_utf8_Copy(entryPtr->value, valuePtr, sizeof(entryPtr->value), NULL) != LE_OK))
+    {
+        LE_WARN("%s:%u: entry too long, ignoring line", pathPtr, lineNum);
+        le_mem_Release(entryPtr);
+        return;
+    }
+
+    le_dls_Queue(&ProfileEntries, &entryPtr->link);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the profile file, if any, in a single pass.
+ *
+ * Entries are only parsed here; they are applied when their service registers.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadProfile
+(
+    void
+)
+{
+    const char* pathPtr = getenv(PROFILE_PATH_ENV);
+    char line[PROFILE_NAME_BYTES * 2 + LE_CFG_STR_LEN_BYTES];
+    unsigned int lineNum = 0;
+    FILE* filePtr;
+
+    if ((NULL == pathPtr) || ('\0' == *pathPtr))
+    {
+        return;
+    }
+
+    filePtr = fopen(pathPtr, "r");
+    if (NULL == filePtr)
+    {
+        LE_ERROR("Unable to open profile %s: %m", pathPtr);
+        return;
+    }
+
+    while (NULL != fgets(line, sizeof(line), filePtr))
+    {
+        lineNum++;
+        ParseProfileLine(pathPtr, lineNum, line);
+    }
+
+    fclose(filePtr);
+
+    LE_INFO("Loaded profile %s: %zu entries", pathPtr, le_dls_NumLinks(&ProfileEntries));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply, and then discard, the profile entries of a service.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyProfile
+(
+    const ConfigService_t* servicePtr   ///< Service being registered
+)
+{
+    le_dls_Link_t* linkPtr = le_dls_Peek(&ProfileEntries);
+
+    while (NULL != linkPtr)
+    {
+        ProfileEntry_t* entryPtr = CONTAINER_OF(linkPtr, ProfileEntry_t, link);
+        linkPtr = le_dls_PeekNext(&ProfileEntries, linkPtr);
+
+        if (0 != strcmp(entryPtr->serviceName, servicePtr->service.namePtr))
+        {
+            continue;
+        }
+
+        ConfigProperty_t* cachePtr = FindProperty(servicePtr, entryPtr->propertyName);
+        if (NULL == cachePtr)
+        {
+            LE_WARN("Ignoring profile entry %s.%s", entryPtr->serviceName, entryPtr->propertyName);
+        }
+        else if (ApplyValueFromString(servicePtr, cachePtr, entryPtr->value) != LE_OK)
+        {
+            LE_ERROR("Profile entry %s.%s is not expecting '%s', Ignoring value.",
+                     entryPtr->serviceName, entryPtr->propertyName, entryPtr->value);
+        }
+
+        le_dls_Remove(&ProfileEntries, &entryPtr->link);
+        le_mem_Release(entryPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the children of a stem which a walk of the tree would apply to a property.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeletePropertyLeaves
+(
+    const ConfigService_t* servicePtr,          ///< Service of the tree
+    le_cfg_IteratorRef_t iteratorRef            ///< Write iterator, on the stem
+)
+{
+    le_hashmap_It_Ref_t iterRef = le_hashmap_GetIterator(servicePtr->propertiesMap);
+
+    while (le_hashmap_NextNode(iterRef) == LE_OK)
+    {
+        const ConfigProperty_t* cachePtr = le_hashmap_GetValue(iterRef);
+        le_cfg_nodeType_t nodeType = le_cfg_GetNodeType(iteratorRef, cachePtr->propPtr->name);
+
+        if ((LE_CFG_TYPE_STEM != nodeType) && (LE_CFG_TYPE_DOESNT_EXIST != nodeType))
+        {
+            le_cfg_DeleteNode(iteratorRef, cachePtr->propPtr->name);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Go through nodes from the Config tree, and eventually handle them.
+ *
+ * The walk is iterative: the iterator itself keeps the position in the tree, so only the current
+ * depth needs to be tracked and the stack usage does not depend on the shape of the tree. Stems
+ * deeper than the limit of the service are skipped, and the walk stops once its node budget is
+ * exhausted.
+ *
+ * With a write iterator, the leaves are deleted instead of being handled, so that the same limits
+ * decide which nodes are removed.
+ *
+ * @return
+ *      - LE_OK            The whole tree has been walked
+ *      - LE_OUT_OF_RANGE  Part of the tree has been skipped because of the limits
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t HandleConfigNode
+(
+    ConfigService_t* servicePtr,                ///< Service to configure
+    le_cfg_IteratorRef_t iteratorRef,           ///< Ref to iterator, on the service root
+    bool deleteLeaves,                          ///< Delete the leaves instead of handling them,
+                                                ///  iteratorRef being a write iterator
+    uint32_t* nodeCntPtr                        ///< [OUT] Number of nodes visited
+)
+{
+    char name[LE_CFG_STR_LEN_BYTES];
+    le_result_t result = LE_OK;
+    uint32_t depth = 0;
+
+    *nodeCntPtr = 0;
+
+    for (;;)
+    {
+        le_cfg_nodeType_t nodeType = le_cfg_GetNodeType(iteratorRef, "");
+
+        if (*nodeCntPtr >= servicePtr->maxNodes)
+        {
+            LE_WARN("Stopping walk of %s after %"PRIu32" nodes", servicePtr->service.namePtr,
+                    *nodeCntPtr);
+            return LE_OUT_OF_RANGE;
+        }
+        (*nodeCntPtr)++;
+
+        if (nodeType == LE_CFG_TYPE_STEM)
+        {
+            if (depth >= servicePtr->maxDepth)
+            {
+                le_cfg_GetNodeName(iteratorRef, "", name, sizeof(name));
+                LE_WARN("Skipping %s.%s: deeper than %"PRIu32" levels",
+                        servicePtr->service.namePtr, name, servicePtr->maxDepth);
+                result = LE_OUT_OF_RANGE;
+            }
+            else
+            {
+                if (deleteLeaves)
+                {
+                    DeletePropertyLeaves(servicePtr, iteratorRef);
+                }
+                if (le_cfg_GoToFirstChild(iteratorRef) == LE_OK)
+                {
+                    depth++;
+                    continue;
+                }
+            }
+        }
+        else if ((depth > 0) && (!deleteLeaves))
+        {
+            name[0] = '\0';
+            le_cfg_GetNodeName(iteratorRef, "", name, sizeof(name));
+            HandleConfigEntry(iteratorRef, servicePtr, name);
+        }
+
+        // Move to the next sibling, going up as long as the current level is exhausted. The
+        // service root itself has no sibling to visit.
+        while ((depth > 0) && (le_cfg_GoToNextSibling(iteratorRef) != LE_OK))
+        {
+            le_cfg_GoToParent(iteratorRef);
+            depth--;
+        }
+
+        if (depth == 0)
+        {
+            return result;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set simulation configuration as provided in the config tree.
+ */
+//--------------------------------------------------------------------------------------------------
+void ConfigureFromTree
+(
+    ConfigService_t* servicePtr                 ///< Service to configure
+)
+{
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+    le_cfg_IteratorRef_t iteratorRef =
+        le_cfg_CreateReadTxn(servicePtr->service.configTreeRootPathPtr);
+    le_result_t result;
+    uint64_t durationUs;
+
+    servicePtr->generation++;
+    result = HandleConfigNode(servicePtr, iteratorRef, false, &servicePtr->lastNodeCnt);
+    le_cfg_CancelTxn(iteratorRef);
+
+    // Entries removed from the tree keep their current value in the service, but have to be
+    // applied again once they are written back. This is only known if the whole tree was walked.
+    if (LE_OK == result)
+    {
+        le_hashmap_It_Ref_t iterRef = le_hashmap_GetIterator(servicePtr->propertiesMap);
+        while (le_hashmap_NextNode(iterRef) == LE_OK)
+        {
+            ConfigProperty_t* cachePtr = (ConfigProperty_t*)le_hashmap_GetValue(iterRef);
+            if (cachePtr->seenGeneration != servicePtr->generation)
+            {
+                cachePtr->isApplied = false;
+            }
+        }
+    }
+
+    durationUs = GetElapsedUs(startTime);
+    servicePtr->applyCnt++;
+    servicePtr->lastApplyUs = durationUs;
+    servicePtr->totalApplyUs += durationUs;
+    if (durationUs > servicePtr->maxApplyUs)
+    {
+        servicePtr->maxApplyUs = durationUs;
+    }
+
+    LE_DEBUG("Applied %s: %"PRIu32" nodes in %"PRIu64" us", servicePtr->service.namePtr,
+             servicePtr->lastNodeCnt, durationUs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute an average duration.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetAverageUs
+(
+    uint64_t totalUs,               ///< Cumulated duration
+    uint32_t cnt                    ///< Number of samples
+)
+{
+    return (0 == cnt) ? 0 : (totalUs / cnt);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a duration in the config tree, saturated to the range of an integer node.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStatsUs
+(
+    le_cfg_IteratorRef_t iteratorRef,   ///< Write iterator
+    const char* pathPtr,                ///< Node, relative to the iterator
+    uint64_t valueUs                    ///< Duration in microseconds
+)
+{
+    le_cfg_SetInt(iteratorRef, pathPtr, (valueUs > INT32_MAX) ? INT32_MAX : (int32_t)valueUs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the statistics of a service under STATS_ROOT/<service>.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishStats
+(
+    const ConfigService_t* servicePtr   ///< Service
+)
+{
+    char path[LE_CFG_STR_LEN_BYTES];
+    le_cfg_IteratorRef_t iteratorRef;
+    le_hashmap_It_Ref_t iterRef;
+
+    snprintf(path, sizeof(path), STATS_ROOT "/%s", servicePtr->service.namePtr);
+    iteratorRef = le_cfg_CreateWriteTxn(path);
+
+    le_cfg_SetInt(iteratorRef, "applyCnt", (int32_t)servicePtr->applyCnt);
+    le_cfg_SetInt(iteratorRef, "lastNodeCnt", (int32_t)servicePtr->lastNodeCnt);
+    SetStatsUs(iteratorRef, "lastApplyUs", servicePtr->lastApplyUs);
+    SetStatsUs(iteratorRef, "avgApplyUs",
+               GetAverageUs(servicePtr->totalApplyUs, servicePtr->applyCnt));
+    SetStatsUs(iteratorRef, "maxApplyUs", servicePtr->maxApplyUs);
+    le_cfg_SetInt(iteratorRef, "foldedChangeCnt", (int32_t)servicePtr->foldedChangeCnt);
+    SetStatsUs(iteratorRef, "lastLatencyUs", servicePtr->lastLatencyUs);
+    SetStatsUs(iteratorRef, "avgLatencyUs",
+               GetAverageUs(servicePtr->totalLatencyUs, servicePtr->latencyCnt));
+    SetStatsUs(iteratorRef, "maxLatencyUs", servicePtr->maxLatencyUs);
+
+    iterRef = le_hashmap_GetIterator(servicePtr->propertiesMap);
+    while (le_hashmap_NextNode(iterRef) == LE_OK)
+    {
+        const ConfigProperty_t* cachePtr = le_hashmap_GetValue(iterRef);
+
+        if (0 == cachePtr->setterCnt)
+        {
+            continue;
+        }
+
+        le_cfg_GoToNode(iteratorRef, cachePtr->propPtr->name);
+        le_cfg_SetInt(iteratorRef, "setterCnt", (int32_t)cachePtr->setterCnt);
+        SetStatsUs(iteratorRef, "lastSetterUs", cachePtr->lastSetterUs);
+        SetStatsUs(iteratorRef, "avgSetterUs",
+                   GetAverageUs(cachePtr->totalSetterUs, cachePtr->setterCnt));
+        SetStatsUs(iteratorRef, "maxSetterUs", cachePtr->maxSetterUs);
+        le_cfg_GoToNode(iteratorRef, "..");
+    }
+
+    le_cfg_CommitTxn(iteratorRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the changes notified during the coalescing window of a service.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChangeTimerHandler
+(
+    le_timer_Ref_t timerRef
+)
+{
+    ConfigService_t* servicePtr = le_timer_GetContextPtr(timerRef);
+
+    servicePtr->foldedChangeCnt += servicePtr->pendingChangeCnt - 1;
+    LE_INFO("Applying %"PRIu32" configuration change(s) of %s (%"PRIu32" folded so far)",
+            servicePtr->pendingChangeCnt, servicePtr->service.namePtr,
+            servicePtr->foldedChangeCnt);
+    servicePtr->pendingChangeCnt = 0;
+
+    ConfigureFromTree(servicePtr);
+
+    uint64_t latencyUs = GetElapsedUs(servicePtr->firstChangeTime);
+    servicePtr->latencyCnt++;
+    servicePtr->lastLatencyUs = latencyUs;
+    servicePtr->totalLatencyUs += latencyUs;
+    if (latencyUs > servicePtr->maxLatencyUs)
+    {
+        servicePtr->maxLatencyUs = latencyUs;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function trigger to process changes from the config tree.
+ *
+ * The first notification starts the coalescing window of the service; the ones received until it
+ * expires are merged into the same apply pass.
+ */
+//--------------------------------------------------------------------------------------------------
+void ChangeHandler
+(
+    void *contextPtr
+)
+{
+    ConfigService_t* servicePtr = contextPtr;
+
+    LE_DEBUG("Configuration change detected on %s", servicePtr->service.namePtr);
+
+    if (0 == servicePtr->pendingChangeCnt)
+    {
+        servicePtr->firstChangeTime = le_clk_GetRelativeTime();
+    }
+    servicePtr->pendingChangeCnt++;
+    if (!le_timer_IsRunning(servicePtr->changeTimer))
+    {
+        le_timer_Start(servicePtr->changeTimer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append bytes to a snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_OVERFLOW      The buffer is too small
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SnapshotWrite
+(
+    uint8_t* bufPtr,                ///< Snapshot buffer
+    size_t bufSize,                 ///< Size of the buffer
+    size_t* offsetPtr,              ///< Current length of the snapshot, updated
+    const void* dataPtr,            ///< Bytes to append
+    size_t dataLen                  ///< Number of bytes to append
+)
+{
+    if (dataLen > bufSize - *offsetPtr)
+    {
+        return LE_OVERFLOW;
+    }
+
+    memcpy(bufPtr + *offsetPtr, dataPtr, dataLen);
+    *offsetPtr += dataLen;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a name, prefixed by its length, to a snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_OVERFLOW      The buffer is too small, or the name too long
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SnapshotWriteName
+(
+    uint8_t* bufPtr,                ///< Snapshot buffer
+    size_t bufSize,                 ///< Size of the buffer
+    size_t* offsetPtr,              ///< Current length of the snapshot, updated
+    const char* namePtr             ///< Name to append
+)
+{
+    size_t nameLen = strlen(namePtr);
+    uint8_t len = (uint8_t)nameLen;
+
+    if ((nameLen > UINT8_MAX) ||
+        (SnapshotWrite(bufPtr, bufSize, offsetPtr, &len, sizeof(len)) != LE_OK))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return SnapshotWrite(bufPtr, bufSize, offsetPtr, namePtr, nameLen);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append the properties of a service to a snapshot, with the value in effect if any.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_OVERFLOW      The buffer is too small
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SnapshotService
+(
+    const ConfigService_t* servicePtr,  ///< Service to save
+    uint8_t* bufPtr,                    ///< Snapshot buffer
+    size_t bufSize,                     ///< Size of the buffer
+    size_t* offsetPtr                   ///< Current length of the snapshot, updated
+)
+{
+    uint16_t propCnt = 0;
+    size_t propCntOffset;
+    le_hashmap_It_Ref_t iterRef;
+
+    if (SnapshotWriteName(bufPtr, bufSize, offsetPtr, servicePtr->service.namePtr) != LE_OK)
+    {
+        return LE_OVERFLOW;
+    }
+
+    // The count is only known once the properties are written
+    propCntOffset = *offsetPtr;
+    if (SnapshotWrite(bufPtr, bufSize, offsetPtr, &propCnt, sizeof(propCnt)) != LE_OK)
+    {
+        return LE_OVERFLOW;
+    }
+
+    iterRef = le_hashmap_GetIterator(servicePtr->propertiesMap);
+    while (le_hashmap_NextNode(iterRef) == LE_OK)
+    {
+        const ConfigProperty_t* cachePtr = le_hashmap_GetValue(iterRef);
+        const void* valuePtr;
+        uint16_t valueLen;
+        uint8_t nodeType = (uint8_t)(cachePtr->isSet ? cachePtr->nodeType :
+                                                       LE_CFG_TYPE_DOESNT_EXIST);
+
+        switch (nodeType)
+        {
+            case LE_CFG_TYPE_STRING:
+                valuePtr = cachePtr->value.stringValue;
+                valueLen = (uint16_t)strlen(cachePtr->value.stringValue);
+                break;
+
+            case LE_CFG_TYPE_BOOL:
+                valuePtr = &cachePtr->value.boolValue;
+                valueLen = sizeof(cachePtr->value.boolValue);
+                break;
+
+            case LE_CFG_TYPE_INT:
+                valuePtr = &cachePtr->value.intValue;
+                valueLen = sizeof(cachePtr->value.intValue);
+                break;
+
+            case LE_CFG_TYPE_FLOAT:
+                valuePtr = &cachePtr->value.floatValue;
+                valueLen = sizeof(cachePtr->value.floatValue);
+                break;
+
+            case LE_CFG_TYPE_DOESNT_EXIST:
+                valuePtr = "";
+                valueLen = 0;
+                break;
+
+            default:
+                valuePtr = cachePtr->value.blobValue.data;
+                valueLen = (uint16_t)cachePtr->value.blobValue.len;
+                break;
+        }
+
+        if ((SnapshotWriteName(bufPtr, bufSize, offsetPtr, cachePtr->propPtr->name) != LE_OK) ||
+            (SnapshotWrite(bufPtr, bufSize, offsetPtr, &nodeType, sizeof(nodeType)) != LE_OK) ||
+            (SnapshotWrite(bufPtr, bufSize, offsetPtr, &valueLen, sizeof(valueLen)) != LE_OK) ||
+            (SnapshotWrite(bufPtr, bufSize, offsetPtr, valuePtr, valueLen) != LE_OK))
+        {
+            return LE_OVERFLOW;
+        }
+        propCnt++;
+    }
+
+    memcpy(bufPtr + propCntOffset, &propCnt, sizeof(propCnt));
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Serialize the values applied to the properties of every registered service into one binary
+ * snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_OVERFLOW      The buffer is too small
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t simuConfig_Snapshot
+(
+    uint8_t* bufPtr,                ///< [OUT] Buffer receiving the snapshot
+    size_t* lenPtr                  ///< [INOUT] Size of the buffer, then length of the snapshot
+)
+{
+    uint32_t magic = SNAPSHOT_MAGIC;
+    uint16_t version = SNAPSHOT_VERSION;
+    uint16_t serviceCnt = (uint16_t)le_hashmap_Size(ConfigServicesMap);
+    size_t offset = 0;
+    le_hashmap_It_Ref_t iterRef;
+
+    if ((SnapshotWrite(bufPtr, *lenPtr, &offset, &magic, sizeof(magic)) != LE_OK) ||
+        (SnapshotWrite(bufPtr, *lenPtr, &offset, &version, sizeof(version)) != LE_OK) ||
+        (SnapshotWrite(bufPtr, *lenPtr, &offset, &serviceCnt, sizeof(serviceCnt)) != LE_OK))
+    {
+        return LE_OVERFLOW;
+    }
+
+    iterRef = le_hashmap_GetIterator(ConfigServicesMap);
+    while (le_hashmap_NextNode(iterRef) == LE_OK)
+    {
+        if (SnapshotService(le_hashmap_GetValue(iterRef), bufPtr, *lenPtr, &offset) != LE_OK)
+        {
+            return LE_OVERFLOW;
+        }
+    }
+
+    LE_INFO("Snapshot of %"PRIu16" service(s): %zu bytes", serviceCnt, offset);
+    *lenPtr = offset;
+
+    return LE_OK;
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Pool of all registered services.
+ * Read bytes from a snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The snapshot is truncated
  */
 //--------------------------------------------------------------------------------------------------
-static le_mem_PoolRef_t ConfigServicesPool = NULL;
+static le_result_t SnapshotRead
+(
+    const uint8_t* bufPtr,          ///< Snapshot
+    size_t len,                     ///< Length of the snapshot
+    size_t* offsetPtr,              ///< Current read offset, updated
+    void* dataPtr,                  ///< Buffer receiving the bytes, NULL to skip them
+    size_t dataLen                  ///< Number of bytes to read
+)
+{
+    if (dataLen > len - *offsetPtr)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (NULL != dataPtr)
+    {
+        memcpy(dataPtr, bufPtr + *offsetPtr, dataLen);
+    }
+    *offsetPtr += dataLen;
+
+    return LE_OK;
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Hashmap of all registered services.
+ * Read a name, prefixed by its length, from a snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The snapshot is truncated
  */
 //--------------------------------------------------------------------------------------------------
-static le_hashmap_Ref_t ConfigServicesMap = NULL;
+static le_result_t SnapshotReadName
+(
+    const uint8_t* bufPtr,          ///< Snapshot
+    size_t len,                     ///< Length of the snapshot
+    size_t* offsetPtr,              ///< Current read offset, updated
+    char* namePtr                   ///< Buffer receiving the name, of UINT8_MAX + 1 bytes
+)
+{
+    uint8_t nameLen;
+
+    if ((SnapshotRead(bufPtr, len, offsetPtr, &nameLen, sizeof(nameLen)) != LE_OK) ||
+        (SnapshotRead(bufPtr, len, offsetPtr, namePtr, nameLen) != LE_OK))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    namePtr[nameLen] = '\0';
+
+    return LE_OK;
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Find a property structure with the given (service,property) names.
+ * Write the value in effect for a property under the root of its service in the config tree, so
+ * that the next walk of the tree finds it unchanged.
  */
 //--------------------------------------------------------------------------------------------------
-static const simuConfig_Property_t* FindProperty
+static void WriteBackProperty
 (
-    const char* serviceNamePtr,     ///< Service name to find
-    const char* propertyNamePtr     ///< Property name to find
+    le_cfg_IteratorRef_t iteratorRef,   ///< Write iterator, on the service root
+    const ConfigProperty_t* cachePtr    ///< Property
 )
 {
-    const simuConfig_Service_t* servicePtr = le_hashmap_Get(ConfigServicesMap, serviceNamePtr);
+    const char* namePtr = cachePtr->propPtr->name;
 
-    if (NULL != servicePtr)
+    switch (cachePtr->nodeType)
     {
-        // Found service, going through properties
-        int propIdx;
-        for (propIdx = 0; servicePtr->properties[propIdx].name != NULL; propIdx++)
-        {
-            const simuConfig_Property_t* propPtr = &(servicePtr->properties[propIdx]);
+        case LE_CFG_TYPE_STRING:
+            le_cfg_SetString(iteratorRef, namePtr, cachePtr->value.stringValue);
+            break;
 
-            if (0 != strcmp(propPtr->name, propertyNamePtr))
-            {
-                continue;
-            }
+        case LE_CFG_TYPE_BOOL:
+            le_cfg_SetBool(iteratorRef, namePtr, cachePtr->value.boolValue);
+            break;
 
-            // Property found
-            return propPtr;
-        }
-    }
+        case LE_CFG_TYPE_INT:
+            le_cfg_SetInt(iteratorRef, namePtr, cachePtr->value.intValue);
+            break;
+
+        case LE_CFG_TYPE_FLOAT:
+            le_cfg_SetFloat(iteratorRef, namePtr, cachePtr->value.floatValue);
+            break;
 
-    LE_DEBUG("Property for [%s][%s] not found", serviceNamePtr, propertyNamePtr);
-    return NULL;
+        default:
+            le_cfg_SetBinary(iteratorRef, namePtr, cachePtr->value.blobValue.data,
+                             cachePtr->value.blobValue.len);
+            break;
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle an entry from the Config tree.
+ * Put a property back to the value it has before any configuration.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleConfigEntry
+static void RestoreDefaultValue
 (
-    le_cfg_IteratorRef_t iteratorRef,
-    const char* parentNamePtr,
-    const char* entryNamePtr
+    const ConfigService_t* servicePtr,  ///< Service of the property
+    ConfigProperty_t* cachePtr          ///< Property to restore
 )
 {
-    le_cfg_nodeType_t nodeType = le_cfg_GetNodeType(iteratorRef, "");
-
-    // Find the property
-    const simuConfig_Property_t* propPtr = FindProperty(parentNamePtr, entryNamePtr);
+    const char* defaultValuePtr = cachePtr->propPtr->defaultValuePtr;
 
-    if (propPtr == NULL)
+    if (NULL == defaultValuePtr)
     {
-        LE_INFO("Ignoring entry %s.%s", parentNamePtr, entryNamePtr);
+        LE_WARN("No default for %s.%s, keeping its current value", servicePtr->service.namePtr,
+                cachePtr->propPtr->name);
         return;
     }
 
-    switch(nodeType)
+    cachePtr->isApplied = false;
+    if (ApplyValueFromString(servicePtr, cachePtr, defaultValuePtr) != LE_OK)
     {
-        case LE_CFG_TYPE_STRING:
-        {
-            char stringBuffer[LE_CFG_STR_LEN_BYTES];
+        LE_ERROR("Invalid default '%s' for %s.%s", defaultValuePtr, servicePtr->service.namePtr,
+                 cachePtr->propPtr->name);
+    }
+    cachePtr->isSet = false;
+}
 
-            LE_ASSERT(le_cfg_GetString(iteratorRef,
-                                       "",
-                                       stringBuffer,
-                                       sizeof(stringBuffer),
-                                       "") == LE_OK);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Walk a property of a snapshot, either to validate it or to apply it.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The property is invalid or unknown
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ProcessSnapshotProperty
+(
+    ConfigService_t* servicePtr,        ///< Service of the property
+    const uint8_t* bufPtr,              ///< Snapshot
+    size_t len,                         ///< Length of the snapshot
+    size_t* offsetPtr,                  ///< Current read offset, updated
+    le_cfg_IteratorRef_t iteratorRef    ///< Write iterator on the service root to write the
+                                        ///  applied value back, NULL to only check the value
+)
+{
+    char name[UINT8_MAX + 1];
+    ConfigProperty_t* cachePtr;
+    uint8_t nodeType;
+    uint16_t valueLen;
+    const uint8_t* valuePtr;
+    bool apply = (NULL != iteratorRef);
 
+    if ((SnapshotReadName(bufPtr, len, offsetPtr, name) != LE_OK) ||
+        (SnapshotRead(bufPtr, len, offsetPtr, &nodeType, sizeof(nodeType)) != LE_OK) ||
+        (SnapshotRead(bufPtr, len, offsetPtr, &valueLen, sizeof(valueLen)) != LE_OK))
+    {
+        LE_ERROR("Truncated snapshot");
+        return LE_FORMAT_ERROR;
+    }
+    valuePtr = bufPtr + *offsetPtr;
+    if (SnapshotRead(bufPtr, len, offsetPtr, NULL, valueLen) != LE_OK)
+    {
+        LE_ERROR("Truncated snapshot");
+        return LE_FORMAT_ERROR;
+    }
 
-            LE_DEBUG("Setting %s.%s: %s", parentNamePtr, entryNamePtr,
-                                          stringBuffer);
+    cachePtr = FindProperty(servicePtr, name);
+    if (NULL == cachePtr)
+    {
+        LE_ERROR("Snapshot refers to unknown property %s.%s", servicePtr->service.namePtr, name);
+        return LE_FORMAT_ERROR;
+    }
 
-            switch(propPtr->setter.type)
+    switch (nodeType)
+    {
+        case LE_CFG_TYPE_STRING:
+            if (valueLen >= sizeof(cachePtr->value.stringValue))
             {
-                case SIMUCONFIG_HANDLER_STRING:
-                    propPtr->setter.handler.stringFn(stringBuffer);
-                    break;
+                return LE_FORMAT_ERROR;
+            }
+            if (apply)
+            {
+                char stringBuffer[LE_CFG_STR_LEN_BYTES];
 
-                case SIMUCONFIG_HANDLER_COMPLEX:
-                    propPtr->setter.handler.complexFn(parentNamePtr, entryNamePtr, stringBuffer);
-                    break;
+                memcpy(stringBuffer, valuePtr, valueLen);
+                stringBuffer[valueLen] = '\0';
+                cachePtr->isApplied = false;
+                ApplyStringValue(servicePtr, cachePtr, stringBuffer);
+            }
+            break;
 
-                default:
-                    LE_ERROR("Entry %s.%s is not expecting a string, Ignoring value.",
-                             parentNamePtr, entryNamePtr);
-                    break;
+        case LE_CFG_TYPE_BOOL:
+            if (valueLen != sizeof(cachePtr->value.boolValue))
+            {
+                return LE_FORMAT_ERROR;
             }
+            if (apply)
+            {
+                bool value;
 
+                memcpy(&value, valuePtr, sizeof(value));
+                cachePtr->isApplied = false;
+                ApplyBoolValue(servicePtr, cachePtr, value);
+            }
             break;
-        }
 
-        case LE_CFG_TYPE_BOOL:
-        {
-            bool value = le_cfg_GetBool(iteratorRef, "", false);
+        case LE_CFG_TYPE_INT:
+            if (valueLen != sizeof(cachePtr->value.intValue))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            if (apply)
+            {
+                int32_t value;
 
-            LE_DEBUG("Setting %s.%s: %s", parentNamePtr, entryNamePtr,
-                                          value ? "true" : "false");
+                memcpy(&value, valuePtr, sizeof(value));
+                cachePtr->isApplied = false;
+                ApplyIntValue(servicePtr, cachePtr, value);
+            }
+            break;
 
-            switch(propPtr->setter.type)
+        case LE_CFG_TYPE_FLOAT:
+            if (valueLen != sizeof(cachePtr->value.floatValue))
             {
-                case SIMUCONFIG_HANDLER_BOOL:
-                    propPtr->setter.handler.boolFn(value);
-                    break;
+                return LE_FORMAT_ERROR;
+            }
+            if (apply)
+            {
+                double value;
 
-                case SIMUCONFIG_HANDLER_COMPLEX:
-                    propPtr->setter.handler.complexFn(parentNamePtr, entryNamePtr, &value);
-                    break;
+                memcpy(&value, valuePtr, sizeof(value));
+                cachePtr->isApplied = false;
+                ApplyFloatValue(servicePtr, cachePtr, value);
+            }
+            break;
 
-                default:
-                    LE_ERROR("Entry %s.%s is not expecting a bool, Ignoring value.",
-                             parentNamePtr, entryNamePtr);
-                    break;
+        case LE_CFG_TYPE_DOESNT_EXIST:
+            if (0 != valueLen)
+            {
+                return LE_FORMAT_ERROR;
             }
+            if (apply)
+            {
+                // Nothing to write back, the default is in effect without any node
+                RestoreDefaultValue(servicePtr, cachePtr);
+                return LE_OK;
+            }
+            break;
 
+        case LE_CFG_TYPE_EMPTY:
+            if ((valueLen > sizeof(cachePtr->value.blobValue.data)) ||
+                (SIMUCONFIG_HANDLER_BLOB != cachePtr->propPtr->setter.type))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            if (apply)
+            {
+                cachePtr->isApplied = false;
+                ApplyBlobValue(servicePtr, cachePtr, valuePtr, valueLen);
+            }
             break;
-        }
 
         default:
-            LE_ERROR("Node type %d not handled", nodeType);
-            break;
+            LE_ERROR("Invalid node type %u in snapshot", nodeType);
+            return LE_FORMAT_ERROR;
+    }
+
+    if (apply)
+    {
+        WriteBackProperty(iteratorRef, cachePtr);
     }
+
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Go through nodes from the Config tree, and eventually handle them.
+ * Walk a snapshot, either to validate it or to apply it.
+ *
+ * When applied, the snapshot also replaces the properties found in the config tree of each
+ * service: every leaf the walk of the tree would apply is deleted, at any depth, and the restored
+ * values are written back under the root, so that the next change notification does not undo the
+ * restore. The changes are made through the transaction of the caller.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The snapshot is invalid, or refers to unknown services or properties
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleConfigNode
+static le_result_t ProcessSnapshot
 (
-    const simuConfig_Service_t* servicePtr,     ///< Service to configure
-    le_cfg_IteratorRef_t iteratorRef            ///< Ref to iterator
+    const uint8_t* bufPtr,              ///< Snapshot
+    size_t len,                         ///< Length of the snapshot
+    le_cfg_IteratorRef_t iteratorRef    ///< Write iterator on the root of the tree to apply the
+                                        ///  values, NULL to only check them
 )
 {
-    do
+    uint32_t magic;
+    uint16_t version;
+    uint16_t serviceCnt;
+    size_t offset = 0;
+    char name[UINT8_MAX + 1];
+
+    if ((SnapshotRead(bufPtr, len, &offset, &magic, sizeof(magic)) != LE_OK) ||
+        (SnapshotRead(bufPtr, len, &offset, &version, sizeof(version)) != LE_OK) ||
+        (SnapshotRead(bufPtr, len, &offset, &serviceCnt, sizeof(serviceCnt)) != LE_OK) ||
+        (SNAPSHOT_MAGIC != magic) || (SNAPSHOT_VERSION != version))
     {
-        le_cfg_nodeType_t nodeType;
+        LE_ERROR("Invalid snapshot header");
+        return LE_FORMAT_ERROR;
+    }
 
-        nodeType = le_cfg_GetNodeType(iteratorRef, "");
+    while (serviceCnt-- > 0)
+    {
+        ConfigService_t* servicePtr;
+        le_result_t result = LE_OK;
+        uint16_t propCnt;
 
-        if (nodeType == LE_CFG_TYPE_STEM)
+        if ((SnapshotReadName(bufPtr, len, &offset, name) != LE_OK) ||
+            (SnapshotRead(bufPtr, len, &offset, &propCnt, sizeof(propCnt)) != LE_OK))
         {
-            if (le_cfg_GoToFirstChild(iteratorRef) == LE_OK)
-            {
-                HandleConfigNode(servicePtr, iteratorRef);
-                le_cfg_GoToNode(iteratorRef, "..");
-            }
+            LE_ERROR("Truncated snapshot");
+            return LE_FORMAT_ERROR;
         }
-        else
+
+        servicePtr = le_hashmap_Get(ConfigServicesMap, name);
+        if (NULL == servicePtr)
         {
-            char name[LE_CFG_STR_LEN_BYTES] = {0};
-            le_cfg_GetNodeName(iteratorRef, "", name, sizeof(name));
-            HandleConfigEntry(iteratorRef, servicePtr->namePtr, name);
+            LE_ERROR("Snapshot refers to unknown service %s", name);
+            return LE_FORMAT_ERROR;
+        }
+
+        if (NULL != iteratorRef)
+        {
+            uint32_t nodeCnt;
+
+            le_cfg_GoToNode(iteratorRef, servicePtr->service.configTreeRootPathPtr);
+            HandleConfigNode(servicePtr, iteratorRef, true, &nodeCnt);
+
+            // The walk may stop below the root when its limits are reached
+            le_cfg_GoToNode(iteratorRef, servicePtr->service.configTreeRootPathPtr);
+        }
+
+        while ((LE_OK == result) && (propCnt-- > 0))
+        {
+            result = ProcessSnapshotProperty(servicePtr, bufPtr, len, &offset, iteratorRef);
+        }
+
+        if (LE_OK != result)
+        {
+            return result;
         }
     }
-    while (le_cfg_GoToNextSibling(iteratorRef) == LE_OK);
+
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Set simulation configuration as provided in the config tree.
+ * Restore the property values saved by simuConfig_Snapshot().
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The snapshot is invalid, or refers to unknown services or properties;
+ *                         nothing has been applied
  */
 //--------------------------------------------------------------------------------------------------
-void ConfigureFromTree
+le_result_t simuConfig_Restore
 (
-    const simuConfig_Service_t* servicePtr      ///< Service to configure
+    const uint8_t* bufPtr,          ///< [IN] Snapshot
+    size_t len                      ///< [IN] Length of the snapshot
 )
 {
-    le_cfg_IteratorRef_t iteratorRef = le_cfg_CreateReadTxn(servicePtr->configTreeRootPathPtr);
-    HandleConfigNode(servicePtr, iteratorRef);
-    le_cfg_CancelTxn(iteratorRef);
+    le_cfg_IteratorRef_t iteratorRef;
+
+    // Validate everything first, so that a bad snapshot leaves the services untouched: the setters
+    // cannot be undone once called
+    if (ProcessSnapshot(bufPtr, len, NULL) != LE_OK)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    // The config tree of every service is updated in one transaction, committed once all of them
+    // have been applied
+    LE_INFO("Restoring snapshot of %zu bytes", len);
+    iteratorRef = le_cfg_CreateWriteTxn("/");
+    LE_ASSERT(ProcessSnapshot(bufPtr, len, iteratorRef) == LE_OK);
+    le_cfg_CommitTxn(iteratorRef);
+
+    return LE_OK;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Function trigger to process changes from the config tree.
+ * Check that a snapshot name designates a single node under SNAPSHOTS_ROOT.
+ *
+ * @return Whether the name is valid.
  */
 //--------------------------------------------------------------------------------------------------
-void ChangeHandler
+static bool IsValidSnapshotName
 (
-    void *contextPtr
+    const char* namePtr             ///< Name of the snapshot
+)
+{
+    if (('\0' == namePtr[0]) || (NULL != strchr(namePtr, '/')) || (NULL != strstr(namePtr, "..")))
+    {
+        LE_ERROR("Invalid snapshot name '%s'", namePtr);
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take or restore the snapshots named in the control nodes of the config tree, and publish the
+ * statistics if requested.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ControlChangeHandler
+(
+    void* contextPtr
+)
+{
+    static uint8_t snapshot[LE_CFG_BINARY_LEN];
+    char snapshotName[LE_CFG_STR_LEN_BYTES] = {0};
+    char restoreName[LE_CFG_STR_LEN_BYTES] = {0};
+    char path[LE_CFG_STR_LEN_BYTES];
+    size_t snapshotLen = sizeof(snapshot);
+    le_cfg_IteratorRef_t iteratorRef;
+    bool isStatsRequested;
+
+    // Consume the requests; their removal notifies this handler again, with nothing to do
+    iteratorRef = le_cfg_CreateWriteTxn(CONTROL_ROOT);
+    le_cfg_GetString(iteratorRef, CONTROL_SNAPSHOT_NODE, snapshotName, sizeof(snapshotName), "");
+    le_cfg_GetString(iteratorRef, CONTROL_RESTORE_NODE, restoreName, sizeof(restoreName), "");
+    isStatsRequested = le_cfg_NodeExists(iteratorRef, CONTROL_STATS_NODE);
+    if (('\0' == snapshotName[0]) && ('\0' == restoreName[0]) && (!isStatsRequested))
+    {
+        le_cfg_CancelTxn(iteratorRef);
+        return;
+    }
+    le_cfg_DeleteNode(iteratorRef, CONTROL_SNAPSHOT_NODE);
+    le_cfg_DeleteNode(iteratorRef, CONTROL_RESTORE_NODE);
+    le_cfg_DeleteNode(iteratorRef, CONTROL_STATS_NODE);
+    le_cfg_CommitTxn(iteratorRef);
+
+    if (isStatsRequested)
+    {
+        simuConfig_DumpStats();
+    }
+
+    if (('\0' != snapshotName[0]) && IsValidSnapshotName(snapshotName))
+    {
+        snprintf(path, sizeof(path), SNAPSHOTS_ROOT "/%s", snapshotName);
+        if (simuConfig_Snapshot(snapshot, &snapshotLen) != LE_OK)
+        {
+            LE_ERROR("Snapshot %s does not fit in the config tree", snapshotName);
+        }
+        else
+        {
+            iteratorRef = le_cfg_CreateWriteTxn(path);
+            le_cfg_SetBinary(iteratorRef, "", snapshot, snapshotLen);
+            le_cfg_CommitTxn(iteratorRef);
+        }
+    }
+
+    if (('\0' != restoreName[0]) && IsValidSnapshotName(restoreName))
+    {
+        snprintf(path, sizeof(path), SNAPSHOTS_ROOT "/%s", restoreName);
+        snapshotLen = sizeof(snapshot);
+        iteratorRef = le_cfg_CreateReadTxn(path);
+        if (le_cfg_GetBinary(iteratorRef, "", snapshot, &snapshotLen, NULL, 0) != LE_OK)
+        {
+            LE_ERROR("Unable to read snapshot %s", restoreName);
+        }
+        else if (simuConfig_Restore(snapshot, snapshotLen) != LE_OK)
+        {
+            LE_ERROR("Unable to restore snapshot %s", restoreName);
+        }
+        le_cfg_CancelTxn(iteratorRef);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Log the apply and setter statistics of every registered service, and publish them in the config
+ * tree.
+ */
+//--------------------------------------------------------------------------------------------------
+void simuConfig_DumpStats
+(
+    void
 )
 {
-    LE_INFO("Configuration change detected");
-    ConfigureFromTree(contextPtr);
+    le_hashmap_It_Ref_t serviceIterRef = le_hashmap_GetIterator(ConfigServicesMap);
+
+    while (le_hashmap_NextNode(serviceIterRef) == LE_OK)
+    {
+        const ConfigService_t* servicePtr = le_hashmap_GetValue(serviceIterRef);
+        le_hashmap_It_Ref_t iterRef;
+
+        PublishStats(servicePtr);
+
+        LE_INFO("%s: %"PRIu32" apply passes (last %"PRIu32" nodes),"
+                " apply last/avg/max %"PRIu64"/%"PRIu64"/%"PRIu64" us,"
+                " %"PRIu32" changes folded, latency last/avg/max %"PRIu64"/%"PRIu64"/%"PRIu64" us",
+                servicePtr->service.namePtr, servicePtr->applyCnt, servicePtr->lastNodeCnt,
+                servicePtr->lastApplyUs,
+                GetAverageUs(servicePtr->totalApplyUs, servicePtr->applyCnt),
+                servicePtr->maxApplyUs, servicePtr->foldedChangeCnt, servicePtr->lastLatencyUs,
+                GetAverageUs(servicePtr->totalLatencyUs, servicePtr->latencyCnt),
+                servicePtr->maxLatencyUs);
+
+        iterRef = le_hashmap_GetIterator(servicePtr->propertiesMap);
+        while (le_hashmap_NextNode(iterRef) == LE_OK)
+        {
+            const ConfigProperty_t* cachePtr = le_hashmap_GetValue(iterRef);
+
+            if (0 == cachePtr->setterCnt)
+            {
+                continue;
+            }
+
+            LE_INFO("%s.%s: %"PRIu32" setter calls, last/avg/max %"PRIu64"/%"PRIu64"/%"PRIu64" us",
+                    servicePtr->service.namePtr, cachePtr->propPtr->name, cachePtr->setterCnt,
+                    cachePtr->lastSetterUs,
+                    GetAverageUs(cachePtr->totalSetterUs, cachePtr->setterCnt),
+                    cachePtr->maxSetterUs);
+        }
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -229,30 +1877,90 @@ void simuConfig_RegisterService
                                             ///  stay valid.
 )
 {
+    const simuConfig_Property_t* propPtr;
+    size_t propCnt = 0;
+
     LE_INFO("Registering new service %s", servicePtr->namePtr);
 
     // Copy content
     // Note that the structure contain references to arrays stored elsewhere which are not copied.
-    simuConfig_Service_t* entryPtr = le_mem_ForceAlloc(ConfigServicesPool);
-    memcpy(entryPtr, servicePtr, sizeof(simuConfig_Service_t));
+    ConfigService_t* entryPtr = le_mem_ForceAlloc(ConfigServicesPool);
+    memcpy(&entryPtr->service, servicePtr, sizeof(simuConfig_Service_t));
+
+    // Index the properties by name, so that each entry of the tree is found in constant time
+    for (propPtr = servicePtr->properties; propPtr->name != NULL; propPtr++)
+    {
+        propCnt++;
+    }
+    entryPtr->propertiesMap = le_hashmap_Create(servicePtr->namePtr, propCnt,
+                                                le_hashmap_HashString, le_hashmap_EqualsString);
+    for (propPtr = servicePtr->properties; propPtr->name != NULL; propPtr++)
+    {
+        // The first declaration wins, as with a lookup in the array
+        if (le_hashmap_ContainsKey(entryPtr->propertiesMap, propPtr->name))
+        {
+            LE_WARN("Property %s.%s declared twice", servicePtr->namePtr, propPtr->name);
+            continue;
+        }
+
+        ConfigProperty_t* cachePtr = le_mem_ForceAlloc(ConfigPropertiesPool);
+        memset(cachePtr, 0, sizeof(*cachePtr));
+        cachePtr->propPtr = propPtr;
+        le_hashmap_Put(entryPtr->propertiesMap, propPtr->name, cachePtr);
+    }
+    entryPtr->generation = 0;
+
+    // Timer coalescing the change notifications
+    entryPtr->pendingChangeCnt = 0;
+    entryPtr->foldedChangeCnt = 0;
+    entryPtr->changeTimer = le_timer_Create(servicePtr->namePtr);
+    le_timer_SetMsInterval(entryPtr->changeTimer,
+                           (servicePtr->changeWindowMs != 0) ? servicePtr->changeWindowMs :
+                                                               SIMUCONFIG_DEFAULT_CHANGE_WINDOW_MS);
+    le_timer_SetContextPtr(entryPtr->changeTimer, entryPtr);
+    le_timer_SetHandler(entryPtr->changeTimer, ChangeTimerHandler);
+
+    // Walk limits and counters
+    entryPtr->maxDepth = (servicePtr->maxDepth != 0) ? servicePtr->maxDepth :
+                                                       SIMUCONFIG_DEFAULT_MAX_DEPTH;
+    entryPtr->maxNodes = (servicePtr->maxNodes != 0) ? servicePtr->maxNodes :
+                                                       SIMUCONFIG_DEFAULT_MAX_NODES;
+    entryPtr->applyCnt = 0;
+    entryPtr->lastNodeCnt = 0;
+    entryPtr->lastApplyUs = 0;
+    entryPtr->maxApplyUs = 0;
+    entryPtr->totalApplyUs = 0;
+    entryPtr->latencyCnt = 0;
+    entryPtr->lastLatencyUs = 0;
+    entryPtr->maxLatencyUs = 0;
+    entryPtr->totalLatencyUs = 0;
 
     // Register in the map
-    le_hashmap_Put(ConfigServicesMap, entryPtr->namePtr, entryPtr);
+    le_hashmap_Put(ConfigServicesMap, entryPtr->service.namePtr, entryPtr);
 
     // Provide handler to be notified upon changes
     LE_ASSERT(servicePtr->configTreeRootPathPtr != NULL);
     le_cfg_AddChangeHandler(servicePtr->configTreeRootPathPtr, ChangeHandler, entryPtr);
 
-    // Handle existing values
+    // Handle values from the profile, then from the tree which takes precedence
+    ApplyProfile(entryPtr);
     ConfigureFromTree(entryPtr);
 }
 
 COMPONENT_INIT
 {
     // Create memory pool to store the data
-    ConfigServicesPool = le_mem_CreatePool("configServices", sizeof(simuConfig_Service_t));
+    ConfigServicesPool = le_mem_CreatePool("configServices", sizeof(ConfigService_t));
+    ConfigPropertiesPool = le_mem_CreatePool("configProperties", sizeof(ConfigProperty_t));
+    ProfileEntriesPool = le_mem_CreatePool("profileEntries", sizeof(ProfileEntry_t));
 
     // Create hashmap to associate <service> to structure.
     ConfigServicesMap = le_hashmap_Create("configServices", 8, le_hashmap_HashString,
                                                                le_hashmap_EqualsString);
+
+    // Load the simulation profile, applied to each service as it registers
+    LoadProfile();
+
+    // Snapshots requested through the config tree
+    le_cfg_AddChangeHandler(CONTROL_ROOT, ControlChangeHandler, NULL);
 }
@@ -33,6 +33,46 @@ typedef void (*simuConfig_BoolSetter_t)
     const bool value                ///< Value for the property as read from configuration.
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Prototype for an integer setter with just one parameter.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*simuConfig_IntSetter_t)
+(
+    int32_t value                   ///< Value for the property as read from configuration.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Prototype for a floating point setter with just one parameter.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*simuConfig_FloatSetter_t)
+(
+    double value                    ///< Value for the property as read from configuration.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum size of a binary value, in bytes.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIMUCONFIG_BLOB_MAX_BYTES   512
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Prototype for a binary setter.
+ *
+ * The value is stored base64 encoded in the configuration, and decoded before being provided.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*simuConfig_BlobSetter_t)
+(
+    const uint8_t* dataPtr,         ///< Value for the property as read from configuration.
+    size_t dataLen                  ///< Length of the value, at most SIMUCONFIG_BLOB_MAX_BYTES.
+);
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Prototype for a complex property setter.
@@ -55,6 +95,9 @@ typedef union {
     simuConfig_StringSetter_t stringFn;
     simuConfig_BoolSetter_t boolFn;
     simuConfig_ComplexSetter_t complexFn;
+    simuConfig_IntSetter_t intFn;
+    simuConfig_FloatSetter_t floatFn;
+    simuConfig_BlobSetter_t blobFn;
 }
 simuConfig_Setters_t;
 
@@ -66,7 +109,10 @@ simuConfig_Setters_t;
 typedef enum {
     SIMUCONFIG_HANDLER_STRING,
     SIMUCONFIG_HANDLER_BOOL,
-    SIMUCONFIG_HANDLER_COMPLEX
+    SIMUCONFIG_HANDLER_COMPLEX,
+    SIMUCONFIG_HANDLER_INT,         ///< Integer node
+    SIMUCONFIG_HANDLER_FLOAT,       ///< Float node, or integer node converted to a float
+    SIMUCONFIG_HANDLER_BLOB         ///< String node holding a base64 encoded binary value
 }
 simuConfig_HandlerType_t;
 
@@ -89,9 +135,28 @@ simuConfig_Setter_t;
 typedef struct {
     const char* name;               ///< Name of the property
     simuConfig_Setter_t setter;     ///< Handler used to set value
+    const char* defaultValuePtr;    ///< Value in effect before any configuration, written as in a
+                                    ///  profile file. NULL if it cannot be restored.
 }
 simuConfig_Property_t;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default window, in ms, during which change notifications of a service are coalesced into one
+ * apply pass.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIMUCONFIG_DEFAULT_CHANGE_WINDOW_MS     50
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default limits of the config tree walk of a service: depth of the stems below the service root,
+ * and number of nodes visited in one apply pass.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIMUCONFIG_DEFAULT_MAX_DEPTH            8
+#define SIMUCONFIG_DEFAULT_MAX_NODES            1024
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Structure to declare a service.
@@ -101,6 +166,12 @@ typedef struct {
     const char* namePtr;                        ///< Name of the service
     const char* configTreeRootPathPtr;          ///< Root path for the configuration in the ConfigTree
     const simuConfig_Property_t* properties;    ///< Properties
+    uint32_t changeWindowMs;                    ///< Window in ms to coalesce change notifications,
+                                                ///  0 for SIMUCONFIG_DEFAULT_CHANGE_WINDOW_MS
+    uint32_t maxDepth;                          ///< Deepest stem level walked,
+                                                ///  0 for SIMUCONFIG_DEFAULT_MAX_DEPTH
+    uint32_t maxNodes;                          ///< Nodes visited in one apply pass,
+                                                ///  0 for SIMUCONFIG_DEFAULT_MAX_NODES
 }
 simuConfig_Service_t;
 
@@ -118,6 +189,61 @@ LE_SHARED void simuConfig_RegisterService
                                             ///< stay valid.
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Serialize the values applied to the properties of every registered service into one binary
+ * snapshot.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_OVERFLOW      The buffer is too small
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t simuConfig_Snapshot
+(
+    uint8_t* bufPtr,                ///< [OUT] Buffer receiving the snapshot
+    size_t* lenPtr                  ///< [INOUT] Size of the buffer, then length of the snapshot
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restore the property values saved by simuConfig_Snapshot().
+ *
+ * The whole snapshot is validated before any value is applied; the setter of every property it
+ * contains is then called, even if the value did not change. Properties which had no value in
+ * effect when the snapshot was taken are put back to their default value. The config tree of each
+ * service in the snapshot is updated to match, in one transaction committed once every service is
+ * applied: the nodes of its properties are deleted at any depth, and the restored values are
+ * written under the service root. Properties missing from the snapshot keep their current value.
+ *
+ * Only the configured values are restored: the runtime state of the platform adaptors, such as
+ * the stored messages or the PIN attempt counters, is left as is.
+ *
+ * @return
+ *      - LE_OK            On success
+ *      - LE_FORMAT_ERROR  The snapshot is invalid, or refers to unknown services or properties;
+ *                         nothing has been applied
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t simuConfig_Restore
+(
+    const uint8_t* bufPtr,          ///< [IN] Snapshot
+    size_t len                      ///< [IN] Length of the snapshot
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Log the apply and setter statistics of every registered service.
+ *
+ * The same statistics are published in the config tree, under /simulation/stats/<service>. This is
+ * also done by setting /simulation/control/stats.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void simuConfig_DumpStats
+(
+    void
+);
+
 #else
 
 //--------------------------------------------------------------------------------------------------
@@ -128,6 +254,14 @@ LE_SHARED void simuConfig_RegisterService
 #define simuConfig_RegisterService(X) \
     (void)(X)
 
+#define simuConfig_Snapshot(BUF, LEN) \
+    ((void)(BUF), (void)(LEN), LE_UNSUPPORTED)
+
+#define simuConfig_Restore(BUF, LEN) \
+    ((void)(BUF), (void)(LEN), LE_UNSUPPORTED)
+
+#define simuConfig_DumpStats()
+
 #endif
 
 #endif // PA_SIMUCONFIG_H_INCLUDE_GUARD
@@ -0,0 +1,734 @@
+/**
+ * @file smsSimuBench.c
+ *
+ * Throughput and latency benchmark of the simulated SMS path.
+ *
+ * The benchmark connects to the SMS server of the simulated platform adaptor and measures:
+ * - the reception path: PDUs are injected on the socket at a given rate and size mix, and the
+ *   latency is measured until the platform adaptor reports, with a PA_SIMU_SMS_FRAME_DELIVERED
+ *   frame, that the new message handler has been called for them.
+ * - the emission path: messages are sent with le_sms_Send(), i.e. through pa_sms_SendPduMsg(), and
+ *   the latency is measured until they are received back on the socket.
+ *
+ * The received messages are deleted from the storage as they come, so that the storage never
+ * fills up. Results are printed as messages per second and p50/p99/p999 latencies.
+ *
+ * Arguments:
+ * - --host=<address>  address of the SMS server (default 127.0.0.1)
+ * - --port=<port>     port of the SMS server (default 5000)
+ * - --unix=<path>     Unix socket of the SMS server, '@' prefix for abstract, instead of TCP
+ * - --count=<n>       number of PDUs to inject (default 1000)
+ * - --rate=<n>        injection rate in messages per second, 0 for as fast as possible (default 0)
+ * - --window=<n>      maximum number of injected PDUs not reported yet (default 64)
+ * - --sizes=<list>    comma-separated user data lengths, used in turn (default 16,80,140)
+ * - --send=<n>        number of messages sent with le_sms_Send() (default 100)
+ * - --dest=<number>   destination of the sent messages (default +15550000001)
+ * - --timeout=<s>     seconds without progress before giving up (default 10)
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include "pa_sms_simu.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Limits of the benchmark.
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_MAX_SIZES         16
+#define BENCH_MAX_WINDOW        4096
+#define BENCH_MAX_COUNT         1000000
+#define BENCH_MAX_UD_LEN        140
+#define BENCH_RATE_TICK_MS      10
+#define BENCH_RX_BUFFER_SIZE    4096
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Originating address of the injected PDUs.
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_ORIG_ADDRESS      "+15550001234"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Latencies of one path, in microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    const char* namePtr;        ///< Name of the path
+    uint64_t* latenciesPtr;     ///< Latency of each message
+    uint32_t count;             ///< Number of latencies
+    uint32_t failedCnt;         ///< Number of messages not handled
+    uint64_t startUs;           ///< Time of the first message
+    uint64_t endUs;             ///< Time of the last message
+}
+BenchPath_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * FIFO of the send times of the messages in flight.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct {
+    uint64_t timesUs[BENCH_MAX_WINDOW];
+    uint32_t head;
+    uint32_t count;
+}
+BenchFifo_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Settings.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* Host = "127.0.0.1";
+static int Port = PA_SIMU_SMS_DEFAULT_PORT;
+static const char* UnixPath = NULL;
+static int Count = 1000;
+static int Rate = 0;
+static int Window = 64;
+static const char* SizesStr = "16,80,140";
+static int SendCount = 100;
+static const char* Destination = "+15550000001";
+static int Timeout = 10;
+
+static uint32_t Sizes[BENCH_MAX_SIZES];
+static uint32_t SizeCnt;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State.
+ */
+//--------------------------------------------------------------------------------------------------
+static int ServerFd = -1;
+static uint8_t RxBuffer[BENCH_RX_BUFFER_SIZE];
+static size_t RxLen;
+
+static BenchPath_t RxPath = { .namePtr = "inject -> new message handler" };
+static BenchPath_t TxPath = { .namePtr = "le_sms_Send -> socket" };
+static BenchFifo_t RxFifo;
+static BenchFifo_t TxFifo;
+
+static uint32_t InjectedCnt;
+static uint32_t SentCnt;
+static double RateCredit;
+static le_timer_Ref_t RateTimer;
+static le_timer_Ref_t WatchdogTimer;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time in microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t NowUs
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return ((uint64_t)now.sec * 1000000) + now.usec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a send time in a FIFO.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushTime
+(
+    BenchFifo_t* fifoPtr,   ///< [IN] FIFO
+    uint64_t timeUs         ///< [IN] Send time
+)
+{
+    LE_ASSERT(fifoPtr->count < BENCH_MAX_WINDOW);
+
+    fifoPtr->timesUs[(fifoPtr->head + fifoPtr->count) % BENCH_MAX_WINDOW] = timeUs;
+    fifoPtr->count++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pop the oldest send time of a FIFO and record the latency of the message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordLatency
+(
+    BenchFifo_t* fifoPtr,   ///< [IN] FIFO
+    BenchPath_t* pathPtr,   ///< [IN] Path the message went through
+    bool succeeded          ///< [IN] Whether the message was handled
+)
+{
+    uint64_t nowUs = NowUs();
+
+    if (0 == fifoPtr->count)
+    {
+        LE_WARN("Unexpected message on path '%s'", pathPtr->namePtr);
+        return;
+    }
+
+    if (succeeded)
+    {
+        pathPtr->latenciesPtr[pathPtr->count++] = nowUs - fifoPtr->timesUs[fifoPtr->head];
+    }
+    else
+    {
+        pathPtr->failedCnt++;
+    }
+    pathPtr->endUs = nowUs;
+
+    fifoPtr->head = (fifoPtr->head + 1) % BENCH_MAX_WINDOW;
+    fifoPtr->count--;
+
+    le_timer_Restart(WatchdogTimer);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two latencies, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareLatencies
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    uint64_t a = *(const uint64_t*)aPtr;
+    uint64_t b = *(const uint64_t*)bPtr;
+
+    return (a > b) - (a < b);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Print the results of one path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrintPath
+(
+    BenchPath_t* pathPtr    ///< [IN] Path
+)
+{
+    uint64_t* latPtr = pathPtr->latenciesPtr;
+    uint32_t n = pathPtr->count;
+    double durationS = (pathPtr->endUs - pathPtr->startUs) / 1e6;
+
+    printf("%s: %u messages, %u failed", pathPtr->namePtr, n, pathPtr->failedCnt);
+    if (0 == n)
+    {
+        printf("\n");
+        return;
+    }
+
+    qsort(latPtr, n, sizeof(uint64_t), CompareLatencies);
+
+    printf(", %.1f msgs/s, latency us p50=%" PRIu64 " p99=%" PRIu64 " p999=%" PRIu64
+           " max=%" PRIu64 "\n",
+           (durationS > 0) ? (n / durationS) : 0.0,
+           latPtr[((n - 1) * 500) / 1000],
+           latPtr[((n - 1) * 990) / 1000],
+           latPtr[((n - 1) * 999) / 1000],
+           latPtr[n - 1]);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Print the results and exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Finish
+(
+    void
+)
+{
+    PrintPath(&RxPath);
+    PrintPath(&TxPath);
+
+    if (RxFifo.count || TxFifo.count)
+    {
+        printf("%u injected and %u sent messages not received\n", RxFifo.count, TxFifo.count);
+        exit(EXIT_FAILURE);
+    }
+
+    exit(((RxPath.failedCnt + TxPath.failedCnt) > 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give up when nothing happened for the configured timeout.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WatchdogHandler
+(
+    le_timer_Ref_t timerRef
+)
+{
+    LE_ERROR("No progress for %d s", Timeout);
+    Finish();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send one frame to the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SendFrame
+(
+    const pa_sms_SimuPdu_t* framePtr    ///< [IN] Frame
+)
+{
+    size_t frameLen = sizeof(pa_sms_SimuPdu_t) + framePtr->dataLen;
+
+    if (send(ServerFd, framePtr, frameLen, MSG_NOSIGNAL) != (ssize_t)frameLen)
+    {
+        LE_FATAL("Unable to send frame: %m");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build a GSM SMS-DELIVER with 8-bit user data of a given length.
+ *
+ * @return Length of the PDU.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t BuildDeliverPdu
+(
+    uint8_t* pduPtr,        ///< [OUT] PDU
+    uint32_t udLen,         ///< [IN] Length of the user data
+    uint32_t seq            ///< [IN] Sequence number, written in the user data
+)
+{
+    const char* digitPtr = BENCH_ORIG_ADDRESS + 1;
+    uint32_t digitCnt = strlen(digitPtr);
+    uint32_t pos = 0;
+    uint32_t i;
+
+    pduPtr[pos++] = 0x00;           // No SMSC information
+    pduPtr[pos++] = 0x04;           // SMS-DELIVER, no more messages to send
+    pduPtr[pos++] = digitCnt;
+    pduPtr[pos++] = 0x91;           // International number
+    for (i = 0; i < digitCnt; i += 2)
+    {
+        uint8_t high = ((i + 1) < digitCnt) ? (digitPtr[i + 1] - '0') : 0x0F;
+        pduPtr[pos++] = (high << 4) | (digitPtr[i] - '0');
+    }
+    pduPtr[pos++] = 0x00;           // TP-PID
+    pduPtr[pos++] = 0x04;           // TP-DCS: 8-bit data
+    memset(&pduPtr[pos], 0x00, 7);  // TP-SCTS
+    pos += 7;
+    pduPtr[pos++] = udLen;
+    for (i = 0; i < udLen; i++)
+    {
+        pduPtr[pos++] = (uint8_t)(seq + i);
+    }
+
+    return pos;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Inject one PDU on the socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InjectOne
+(
+    void
+)
+{
+    union {
+        pa_sms_SimuPdu_t header;
+        uint8_t buffer[sizeof(pa_sms_SimuPdu_t) + PA_SIMU_SMS_MAX_PDU_DATA_LEN];
+    } frame;
+
+    memset(&frame.header, 0, sizeof(frame.header));
+    frame.header.protocol = PA_SMS_PROTOCOL_GSM;
+    le_utf8_Copy((char*)frame.header.origAddress, BENCH_ORIG_ADDRESS,
+                 sizeof(frame.header.origAddress), NULL);
+    frame.header.dataLen = BuildDeliverPdu(frame.header.data, Sizes[InjectedCnt % SizeCnt],
+                                           InjectedCnt);
+
+    if (0 == InjectedCnt)
+    {
+        RxPath.startUs = NowUs();
+    }
+
+    PushTime(&RxFifo, NowUs());
+    SendFrame(&frame.header);
+    InjectedCnt++;
+}
+
+static void CheckProgress(void);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send the next message through le_sms, then queue the next one so that the socket is read in
+ * between.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SendNext
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    le_sms_MsgRef_t msgRef;
+    le_result_t result;
+    uint64_t sendUs;
+
+    if (SentCnt >= (uint32_t)SendCount)
+    {
+        return;
+    }
+
+    if (TxFifo.count >= (uint32_t)Window)
+    {
+        // Resumed when a message is received back
+        return;
+    }
+
+    msgRef = le_sms_Create();
+    LE_FATAL_IF(LE_OK != le_sms_SetDestination(msgRef, Destination), "Invalid destination");
+    LE_FATAL_IF(LE_OK != le_sms_SetText(msgRef, "smsSimuBench"), "Unable to set text");
+
+    sendUs = NowUs();
+    if (0 == SentCnt)
+    {
+        TxPath.startUs = sendUs;
+    }
+
+    // The message cannot be received back before the socket is read, once this returns
+    result = le_sms_Send(msgRef);
+    le_sms_Delete(msgRef);
+    SentCnt++;
+
+    if (LE_OK == result)
+    {
+        PushTime(&TxFifo, sendUs);
+    }
+    else
+    {
+        LE_ERROR("Unable to send message %u: %s", SentCnt, LE_RESULT_TXT(result));
+        TxPath.failedCnt++;
+        CheckProgress();
+    }
+
+    le_event_QueueFunction(SendNext, NULL, NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the emission path, or finish, once the reception path is done.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckProgress
+(
+    void
+)
+{
+    if ((InjectedCnt < (uint32_t)Count) || (RxFifo.count > 0))
+    {
+        return;
+    }
+
+    if (0 == SentCnt)
+    {
+        le_event_QueueFunction(SendNext, NULL, NULL);
+    }
+
+    if ((SentCnt >= (uint32_t)SendCount) && (0 == TxFifo.count))
+    {
+        Finish();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Inject PDUs, within the window and the rate credit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Inject
+(
+    void
+)
+{
+    while ((InjectedCnt < (uint32_t)Count) && (RxFifo.count < (uint32_t)Window))
+    {
+        if (Rate > 0)
+        {
+            if (RateCredit < 1)
+            {
+                return;
+            }
+            RateCredit -= 1;
+        }
+
+        InjectOne();
+    }
+
+    CheckProgress();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the rate credit of one tick and inject.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RateTimerHandler
+(
+    le_timer_Ref_t timerRef
+)
+{
+    RateCredit += (double)Rate * BENCH_RATE_TICK_MS / 1000;
+
+    // Do not accumulate credit while the window is full
+    if (RateCredit > Window)
+    {
+        RateCredit = Window;
+    }
+
+    Inject();
+
+    if (InjectedCnt >= (uint32_t)Count)
+    {
+        le_timer_Stop(timerRef);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle one frame received from the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFrame
+(
+    const pa_sms_SimuPdu_t* framePtr    ///< [IN] Frame
+)
+{
+    switch ((uint32_t)framePtr->protocol)
+    {
+        case PA_SIMU_SMS_FRAME_DELIVERED:
+        {
+            const pa_sms_SimuBatchResult_t* resultPtr =
+                (const pa_sms_SimuBatchResult_t*)framePtr->data;
+            uint32_t i;
+
+            for (i = 0; i < (framePtr->dataLen / sizeof(pa_sms_SimuBatchResult_t)); i++)
+            {
+                RecordLatency(&RxFifo, &RxPath, (LE_OK == resultPtr[i].result));
+            }
+            Inject();
+            break;
+        }
+
+        case PA_SIMU_SMS_FRAME_BATCH_ACK:
+            break;
+
+        default:
+            // Message sent through pa_sms_SendPduMsg()
+            RecordLatency(&TxFifo, &TxPath, true);
+            le_event_QueueFunction(SendNext, NULL, NULL);
+            CheckProgress();
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the frames received from the SMS server.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ServerEventHandler
+(
+    int fd,
+    short events
+)
+{
+    ssize_t readSz;
+    size_t offset = 0;
+
+    readSz = recv(fd, RxBuffer + RxLen, sizeof(RxBuffer) - RxLen, MSG_DONTWAIT);
+    if (readSz <= 0)
+    {
+        if ((readSz < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+        {
+            return;
+        }
+        LE_ERROR("Connection to the SMS server lost");
+        Finish();
+    }
+    RxLen += readSz;
+
+    while ((RxLen - offset) >= sizeof(pa_sms_SimuPdu_t))
+    {
+        const pa_sms_SimuPdu_t* framePtr = (const pa_sms_SimuPdu_t*)(RxBuffer + offset);
+        size_t frameLen = sizeof(pa_sms_SimuPdu_t) + framePtr->dataLen;
+
+        LE_FATAL_IF(frameLen > sizeof(RxBuffer), "Invalid frame length %zu", frameLen);
+        if ((RxLen - offset) < frameLen)
+        {
+            break;
+        }
+
+        HandleFrame(framePtr);
+        offset += frameLen;
+    }
+
+    memmove(RxBuffer, RxBuffer + offset, RxLen - offset);
+    RxLen -= offset;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the received messages, so that the storage does not fill up.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RxMessageHandler
+(
+    le_sms_MsgRef_t msgRef,
+    void* contextPtr
+)
+{
+    le_sms_DeleteFromStorage(msgRef);
+    le_sms_Delete(msgRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the size mix.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseSizes
+(
+    void
+)
+{
+    const char* strPtr = SizesStr;
+
+    SizeCnt = 0;
+    while (*strPtr && (SizeCnt < BENCH_MAX_SIZES))
+    {
+        char* endPtr;
+        unsigned long size = strtoul(strPtr, &endPtr, 10);
+
+        LE_FATAL_IF((endPtr == strPtr) || (size > BENCH_MAX_UD_LEN),
+                    "Invalid sizes '%s', expecting lengths up to %d", SizesStr, BENCH_MAX_UD_LEN);
+        Sizes[SizeCnt++] = size;
+        strPtr = (*endPtr == ',') ? (endPtr + 1) : endPtr;
+    }
+
+    LE_FATAL_IF(0 == SizeCnt, "No size given");
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect to the SMS server and ask for delivery reports.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConnectServer
+(
+    void
+)
+{
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* resPtr;
+    char portStr[8];
+    pa_sms_SimuPdu_t request;
+
+    if (NULL != UnixPath)
+    {
+        struct sockaddr_un unixAddr = { .sun_family = AF_UNIX };
+        size_t pathLen = strlen(UnixPath);
+        socklen_t addrLen = offsetof(struct sockaddr_un, sun_path) + pathLen;
+
+        LE_FATAL_IF(pathLen >= sizeof(unixAddr.sun_path), "Unix socket path too long");
+        memcpy(unixAddr.sun_path, UnixPath, pathLen);
+        if ('@' == UnixPath[0])
+        {
+            unixAddr.sun_path[0] = '\0';
+        }
+        else
+        {
+            addrLen++;
+        }
+
+        ServerFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        LE_FATAL_IF(ServerFd < 0, "Unable to create socket: %m");
+        LE_FATAL_IF(0 != connect(ServerFd, (struct sockaddr*)&unixAddr, addrLen),
+                    "Unable to connect to '%s': %m", UnixPath);
+    }
+    else
+    {
+        snprintf(portStr, sizeof(portStr), "%d", Port);
+        LE_FATAL_IF(0 != getaddrinfo(Host, portStr, &hints, &resPtr), "Unknown host '%s'", Host);
+
+        ServerFd = socket(resPtr->ai_family, resPtr->ai_socktype, resPtr->ai_protocol);
+        LE_FATAL_IF(ServerFd < 0, "Unable to create socket: %m");
+        LE_FATAL_IF(0 != connect(ServerFd, resPtr->ai_addr, resPtr->ai_addrlen),
+                    "Unable to connect to %s:%d: %m", Host, Port);
+        freeaddrinfo(resPtr);
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.protocol = PA_SIMU_SMS_FRAME_DELIVERY_REPORTS;
+    SendFrame(&request);
+
+    le_fdMonitor_Create("SmsSimuBench", ServerFd, ServerEventHandler, POLLIN);
+}
+
+COMPONENT_INIT
+{
+    le_arg_SetStringVar(&Host, NULL, "host");
+    le_arg_SetIntVar(&Port, NULL, "port");
+    le_arg_SetStringVar(&UnixPath, NULL, "unix");
+    le_arg_SetIntVar(&Count, NULL, "count");
+    le_arg_SetIntVar(&Rate, NULL, "rate");
+    le_arg_SetIntVar(&Window, NULL, "window");
+    le_arg_SetStringVar(&SizesStr, NULL, "sizes");
+    le_arg_SetIntVar(&SendCount, NULL, "send");
+    le_arg_SetStringVar(&Destination, NULL, "dest");
+    le_arg_SetIntVar(&Timeout, NULL, "timeout");
+    le_arg_Scan();
+
+    LE_FATAL_IF((Count < 0) || (Count > BENCH_MAX_COUNT), "Invalid count %d", Count);
+    LE_FATAL_IF((SendCount < 0) || (SendCount > BENCH_MAX_COUNT), "Invalid send %d", SendCount);
+    LE_FATAL_IF((Window < 1) || (Window > BENCH_MAX_WINDOW), "Invalid window %d", Window);
+    LE_FATAL_IF((Rate < 0) || (Timeout < 1), "Invalid rate or timeout");
+    ParseSizes();
+
+    RxPath.latenciesPtr = calloc(Count ? Count : 1, sizeof(uint64_t));
+    TxPath.latenciesPtr = calloc(SendCount ? SendCount : 1, sizeof(uint64_t));
+    LE_ASSERT(RxPath.latenciesPtr && TxPath.latenciesPtr);
+
+    le_sms_AddRxMessageHandler(RxMessageHandler, NULL);
+
+    ConnectServer();
+
+    WatchdogTimer = le_timer_Create("SmsSimuBenchWatchdog");
+    le_timer_SetHandler(WatchdogTimer, WatchdogHandler);
+    le_timer_SetMsInterval(WatchdogTimer, Timeout * 1000);
+    le_timer_Start(WatchdogTimer);
+
+    LE_INFO("Injecting %d PDUs (rate %d/s, window %d), then sending %d messages",
+            Count, Rate, Window, SendCount);
+
+    if (Rate > 0)
+    {
+        RateTimer = le_timer_Create("SmsSimuBenchRate");
+        le_timer_SetHandler(RateTimer, RateTimerHandler);
+        le_timer_SetMsInterval(RateTimer, BENCH_RATE_TICK_MS);
+        le_timer_SetRepeat(RateTimer, 0);
+        le_timer_Start(RateTimer);
+    }
+    else
+    {
+        Inject();
+    }
+}